@@ -5,6 +5,7 @@
 #include <boost/asio.hpp>
 #include <boost/bind.hpp>
 #include <boost/thread.hpp>
+#include <type_traits>
 #include <vector>
 #include <fc/thread/future.hpp>
 #include <fc/io/iostream.hpp>
@@ -19,6 +20,9 @@ namespace asio {
      */
     namespace detail {
 
+        /** @return the exception a read or write failing with @p ec completes with */
+        fc::exception_ptr operation_error( const boost::system::error_code& ec );
+
         class read_write_handler
         {
         public:
@@ -65,8 +69,119 @@ namespace asio {
             bool operator()( C&, bool ) { return false; } 
         };
 #endif
+
+        /** Puts @p s in non-blocking mode if it supports it, @return whether it is in that mode */
+        template<typename C>
+        bool enable_non_blocking( C& s ) {
+          non_blocking<C> nb;
+          try {
+            return nb( s ) || nb( s, true );
+          } catch( const boost::system::system_error& ) {
+            return false; // not open, the async operation reports that
+          }
+        }
+
+        inline bool would_block( const boost::system::error_code& ec ) {
+          return ec == boost::asio::error::would_block || ec == boost::asio::error::try_again;
+        }
+
+        /** @return @p bytes_transferred, or throws what the async operation would have completed with */
+        inline size_t operation_result( size_t bytes_transferred, const boost::system::error_code& ec ) {
+          if( ec )
+            operation_error( ec )->dynamic_rethrow_exception();
+          return bytes_transferred;
+        }
+
+        /**
+         *  A promise<size_t> that can be set again after reset().  It also holds the memory
+         *  for the async operation that completes it, asio frees that before it calls the
+         *  handler, so it is free again for the next operation.
+         */
+        class reusable_promise : public promise<size_t>
+        {
+        public:
+          reusable_promise();
+          /** @pre the promise is complete and nothing but the caller refers to it */
+          void reset();
+
+          void* allocate( size_t size );
+          void  deallocate( void* p );
+
+        private:
+          static const size_t operation_size = 256;
+          std::aligned_storage<operation_size>::type _operation;
+          bool                                       _operation_used = false;
+        };
+
+        /** Makes asio allocate the operation of a handler in its reusable_promise */
+        template<typename T>
+        class operation_allocator
+        {
+        public:
+          typedef T value_type;
+
+          explicit operation_allocator( reusable_promise* p ) : _promise(p) {}
+          template<typename U>
+          operation_allocator( const operation_allocator<U>& a ) : _promise(a._promise) {}
+
+          T*   allocate( size_t n ) { return static_cast<T*>( _promise->allocate( sizeof(T) * n ) ); }
+          void deallocate( T* p, size_t ) { _promise->deallocate( p ); }
+
+          template<typename U>
+          bool operator==( const operation_allocator<U>& a )const { return _promise == a._promise; }
+          template<typename U>
+          bool operator!=( const operation_allocator<U>& a )const { return _promise != a._promise; }
+
+          reusable_promise* _promise;
+        };
+
+        /** The handler of the async operations of an operation_completion */
+        class reusable_read_write_handler
+        {
+        public:
+          typedef operation_allocator<void> allocator_type;
+
+          reusable_read_write_handler( const std::shared_ptr<reusable_promise>& p,
+                                       std::shared_ptr<const char> buffer = std::shared_ptr<const char>() )
+          :_completion_promise(p),_buffer(std::move(buffer)){}
+
+          void operator()(const boost::system::error_code& ec, size_t bytes_transferred);
+          allocator_type get_allocator()const { return allocator_type( _completion_promise.get() ); }
+        private:
+          std::shared_ptr<reusable_promise> _completion_promise;
+          std::shared_ptr<const char>       _buffer;
+        };
     } // end of namespace detail
 
+    /**
+     *  The completion of the one read or write a stream has in flight at a time,
+     *  for the read_some() and write_some() overloads that return the byte count.
+     *
+     *  Its promise, which also holds the memory of the async operation, is reset and
+     *  reused by the next operation once the handler of the previous one has let go
+     *  of it, so a busy socket does not allocate them per operation.
+     *  Keep one per direction and stream, like tcp_socket does.
+     */
+    class operation_completion
+    {
+       public:
+          /** @return the promise to complete the next async operation with */
+          std::shared_ptr<detail::reusable_promise> next();
+          /**
+           *  @return whether the next operation may be tried without blocking first.  Every
+           *  so often it must not, so that a stream that is always ready still lets the
+           *  other fibers of its thread run.
+           */
+          bool try_immediate();
+          /** Waits until the last async operation completed, ignoring how */
+          void wait_idle();
+
+       private:
+          static const uint32_t                     max_immediate = 64;
+          std::shared_ptr<detail::reusable_promise> _promise;
+          uint32_t                                  _immediate = 0;
+    };
+
     /***
      * A structure for holding the boost io service and associated
      * threads
@@ -164,6 +279,45 @@ namespace asio {
       s.async_read_some(boost::asio::buffer(buffer.get() + offset, length), detail::read_write_handler_with_buffer(completion_promise, buffer));
     }
 
+    /**
+     *  Reads at least 1 byte like the overloads above, but first tries a non-blocking
+     *  read, putting the stream in non-blocking mode if it supports it.  Only if that
+     *  would block it waits for an async read completed through @p completion.
+     *
+     *  @return the number of bytes read.
+     */
+    template<typename AsyncReadStream>
+    size_t read_some(AsyncReadStream& s, char* buffer, size_t length, size_t offset, operation_completion& completion)
+    {
+      if( completion.try_immediate() && detail::enable_non_blocking(s) )
+      {
+        boost::system::error_code ec;
+        const size_t bytes_read = s.read_some(boost::asio::buffer(buffer + offset, length), ec);
+        if( !detail::would_block(ec) )
+          return detail::operation_result(bytes_read, ec);
+      }
+      std::shared_ptr<detail::reusable_promise> completion_promise = completion.next();
+      s.async_read_some(boost::asio::buffer(buffer + offset, length), detail::reusable_read_write_handler(completion_promise));
+      return completion_promise->wait();
+    }
+
+    template<typename AsyncReadStream>
+    size_t read_some(AsyncReadStream& s, const std::shared_ptr<char>& buffer, size_t length, size_t offset,
+                     operation_completion& completion)
+    {
+      if( completion.try_immediate() && detail::enable_non_blocking(s) )
+      {
+        boost::system::error_code ec;
+        const size_t bytes_read = s.read_some(boost::asio::buffer(buffer.get() + offset, length), ec);
+        if( !detail::would_block(ec) )
+          return detail::operation_result(bytes_read, ec);
+      }
+      std::shared_ptr<detail::reusable_promise> completion_promise = completion.next();
+      s.async_read_some(boost::asio::buffer(buffer.get() + offset, length),
+                        detail::reusable_read_write_handler(completion_promise, buffer));
+      return completion_promise->wait();
+    }
+
     template<typename AsyncReadStream>
     size_t read_some( AsyncReadStream& s, boost::asio::streambuf& buf )
     {
@@ -211,6 +365,42 @@ namespace asio {
         return p; //->wait();
     }
 
+    /**
+     *  Writes like the overloads above, but first tries a non-blocking write, see the
+     *  read_some() taking an operation_completion.
+     *
+     *  @return the number of bytes written
+     */
+    template<typename AsyncWriteStream>
+    size_t write_some( AsyncWriteStream& s, const char* buffer, size_t length, size_t offset,
+                       operation_completion& completion ) {
+        if( completion.try_immediate() && detail::enable_non_blocking(s) )
+        {
+          boost::system::error_code ec;
+          const size_t bytes_written = s.write_some( boost::asio::buffer(buffer + offset, length), ec );
+          if( !detail::would_block(ec) )
+            return detail::operation_result( bytes_written, ec );
+        }
+        std::shared_ptr<detail::reusable_promise> p = completion.next();
+        s.async_write_some( boost::asio::buffer(buffer + offset, length), detail::reusable_read_write_handler(p) );
+        return p->wait();
+    }
+
+    template<typename AsyncWriteStream>
+    size_t write_some( AsyncWriteStream& s, const std::shared_ptr<const char>& buffer,
+                       size_t length, size_t offset, operation_completion& completion ) {
+        if( completion.try_immediate() && detail::enable_non_blocking(s) )
+        {
+          boost::system::error_code ec;
+          const size_t bytes_written = s.write_some( boost::asio::buffer(buffer.get() + offset, length), ec );
+          if( !detail::would_block(ec) )
+            return detail::operation_result( bytes_written, ec );
+        }
+        std::shared_ptr<detail::reusable_promise> p = completion.next();
+        s.async_write_some( boost::asio::buffer(buffer.get() + offset, length), detail::reusable_read_write_handler(p, buffer) );
+        return p->wait();
+    }
+
     /**
     *  @pre s.non_blocking() == true
     *  @brief wraps boost::asio::async_write_some
@@ -284,15 +474,16 @@ namespace asio {
 
           virtual size_t readsome( char* buf, size_t len )
           {
-             return fc::asio::read_some(*_stream, buf, len).wait();
+             return fc::asio::read_some(*_stream, buf, len, 0, _completion);
           }
           virtual size_t readsome( const std::shared_ptr<char>& buf, size_t len, size_t offset )
           {
-             return fc::asio::read_some(*_stream, buf, len, offset).wait();
+             return fc::asio::read_some(*_stream, buf, len, offset, _completion);
           }
     
        private:
           std::shared_ptr<AsyncReadStream> _stream;
+          operation_completion             _completion;
     };
 
     template<typename AsyncWriteStream>
@@ -304,18 +495,19 @@ namespace asio {
 
           virtual size_t writesome( const char* buf, size_t len )
           {
-             return fc::asio::write_some(*_stream, buf, len).wait();
+             return fc::asio::write_some(*_stream, buf, len, 0, _completion);
           }
     
           virtual size_t     writesome( const std::shared_ptr<const char>& buf, size_t len, size_t offset )
           {
-             return fc::asio::write_some(*_stream, buf, len, offset).wait();
+             return fc::asio::write_some(*_stream, buf, len, offset, _completion);
           }
     
           virtual void       close(){ _stream->close(); }
           virtual void       flush() {}
        private:
           std::shared_ptr<AsyncWriteStream> _stream;
+          operation_completion              _completion;
     };
 
 
@@ -12,3 +12,8 @@
 // how many elements will be reserve()d when deserializing vectors
 #define FC_MAX_PREALLOC_SIZE (256UL)
 #endif
+
+#ifndef FC_STATIC_VARIANT_MAX_INLINE_SIZE
+// alternatives of a static_variant up to this size are stored inside it, larger ones on the heap
+#define FC_STATIC_VARIANT_MAX_INLINE_SIZE (256UL)
+#endif
@@ -77,6 +77,7 @@ namespace fc {
 
         private:
           friend class private_key;
+          friend std::vector<public_key> recover_batch( const compact_signature*, const fc::sha256*, size_t, bool );
           static public_key from_key_data( const public_key_data& v );
           static bool is_canonical( const compact_signature& c );
           fc::fwd<detail::public_key_impl,33> my;
@@ -226,6 +227,21 @@ namespace fc {
                                           const range_proof_type& proof );
      range_proof_info range_get_info( const range_proof_type& proof );
 
+     /**
+      *  Recovers the public keys of many compact signatures, splitting the work across the
+      *  fc worker pool (@see fc::parallel_for).
+      *
+      *  Element i of the result is recovered from signatures[i] over digests[i].  It is
+      *  left invalid (public_key::valid() returns false) if the signature is malformed,
+      *  not canonical while check_canonical is set, or recovery fails; no exception is
+      *  thrown for a bad signature.
+      */
+     std::vector<public_key> recover_batch( const compact_signature* signatures, const fc::sha256* digests,
+                                            size_t count, bool check_canonical = true );
+     std::vector<public_key> recover_batch( const std::vector<compact_signature>& signatures,
+                                            const std::vector<fc::sha256>& digests,
+                                            bool check_canonical = true );
+
 
 
   } // namespace ecc
@@ -102,6 +102,8 @@ namespace raw {
       ds >> ep;
    }
 
+   template<> struct is_trivially_packed<hash160> : std::true_type {};
+
 }
 
    class variant;
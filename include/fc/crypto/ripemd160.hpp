@@ -83,6 +83,8 @@ namespace raw {
       ds >> ep;
    }
 
+   template<> struct is_trivially_packed<ripemd160> : std::true_type {};
+
 }
 
   class variant;
@@ -81,6 +81,8 @@ namespace raw {
       ds >> ep;
    }
 
+   template<> struct is_trivially_packed<sha1> : std::true_type {};
+
 }
 
   class variant;
@@ -80,6 +80,8 @@ namespace raw {
       ds >> ep;
    }
 
+   template<> struct is_trivially_packed<sha224> : std::true_type {};
+
 }
 
   class variant;
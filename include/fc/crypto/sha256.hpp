@@ -83,6 +83,8 @@ namespace raw {
       ds >> ep;
    }
 
+   template<> struct is_trivially_packed<sha256> : std::true_type {};
+
 }
 
   typedef sha256 uint256;
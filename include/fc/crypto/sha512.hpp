@@ -79,6 +79,8 @@ namespace raw {
       ds >> ep;
    }
 
+   template<> struct is_trivially_packed<sha512> : std::true_type {};
+
 }
 
   typedef fc::sha512 uint512;
@@ -2,6 +2,7 @@
 #include <fc/fwd.hpp>
 #include <cstdint>
 #include <cstdlib>
+#include <memory>
 
 namespace boost {
   namespace interprocess {
@@ -10,6 +11,8 @@ namespace boost {
   }
 }
 namespace fc {
+  class path;
+
   enum mode_t {
     read_only, 
     write_only,
@@ -34,10 +37,43 @@ namespace fc {
       mapped_region( const file_mapping& fm, mode_t m, uint64_t start, size_t size );
       mapped_region( const file_mapping& fm, mode_t m );
       ~mapped_region();
+
+      /** Access pattern hints for the pages of the region, see madvise() */
+      enum advice_t {
+        advice_normal,
+        advice_sequential,
+        advice_random,
+        advice_willneed,
+        advice_dontneed
+      };
+      /** @return false if the hint is not supported on this platform */
+      bool  advise( advice_t a );
+
       void  flush();
       void* get_address()const;
       size_t get_size()const;
     private:
       fc::fwd<boost::interprocess::mapped_region,40> my;
   };
+
+  /**
+   *  A read-only mapping of a whole file, advised for sequential access, so that a
+   *  loader can parse the file in place instead of copying it into a buffer first.
+   *  Only regular files with contents are mapped.  For an empty file, a FIFO or a
+   *  device such as /dev/stdin data() is nullptr, and the caller has to read the
+   *  file as a stream instead.
+   *
+   *  @throws file_not_found_exception if the file does not exist
+   */
+  class mapped_file {
+    public:
+      explicit mapped_file( const fc::path& file );
+      ~mapped_file();
+
+      const char* data()const;
+      size_t      size()const;
+    private:
+      std::unique_ptr<file_mapping>   _mapping;
+      std::unique_ptr<mapped_region>  _region;
+  };
 }
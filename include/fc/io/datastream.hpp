@@ -1,6 +1,7 @@
 #pragma once
 #include <string.h>
 #include <stdint.h>
+#include <vector>
 
 namespace fc {
 
@@ -88,5 +89,51 @@ class datastream<size_t> {
      size_t _size;
 };
 
+/**
+ *  Appends everything written to it to a std::vector<char>, reserving capacity
+ *  geometrically as needed.  This packs an object in one pass instead of first
+ *  measuring it with datastream<size_t>.  Reusing the same vector keeps its
+ *  capacity from one object to the next.  Bytes are appended to the vector, so
+ *  its spare capacity is never filled in advance.
+ */
+template<>
+class datastream<std::vector<char>> {
+   public:
+     datastream( std::vector<char>& buf ):_buf(buf){};
+
+     inline bool skip( size_t s ) {
+       reserve( s );
+       _buf.resize( _buf.size() + s );
+       return true;
+     }
+     inline bool write( const char* d, size_t s ) {
+       reserve( s );
+       _buf.insert( _buf.end(), d, d + s );
+       return true;
+     }
+     inline bool put( char c ) {
+       reserve( 1 );
+       _buf.push_back( c );
+       return true;
+     }
+     inline bool     valid()const                     { return true;              }
+     inline size_t   tellp()const                     { return _buf.size();       }
+     /** @return how much can be written before the vector reallocates */
+     inline size_t   remaining()const                 { return _buf.capacity() - _buf.size(); }
+  private:
+     inline void reserve( size_t s ) {
+       if( _buf.capacity() - _buf.size() < s )
+         grow( s );
+     }
+     void grow( size_t s ) {
+       size_t capacity = 2 * _buf.capacity();
+       if( capacity < _buf.size() + s ) capacity = _buf.size() + s;
+       if( capacity < 64 ) capacity = 64;
+       _buf.reserve( capacity );
+     }
+
+     std::vector<char>& _buf;
+};
+
 } // namespace fc
 
@@ -32,6 +32,24 @@ namespace fc
             stringify_large_ints_and_doubles = 0,
             legacy_generator = 1
          };
+         /** How far save_to_file() makes sure the file reached the disk before it returns */
+         enum sync_policy
+         {
+            no_sync                 = 0, ///< leave it to the OS
+            sync_file               = 1, ///< fsync the file before closing it
+            sync_file_and_directory = 2  ///< also fsync the directory, so that a new or renamed file survives a crash
+         };
+         struct save_options
+         {
+            bool              pretty         = true;
+            output_formatting format         = stringify_large_ints_and_doubles;
+            uint32_t          max_depth      = DEFAULT_MAX_RECURSION_DEPTH;
+            /** Write a temporary file next to the target and rename it over the target once complete */
+            bool              atomic_replace = false;
+            sync_policy       sync           = no_sync;
+            /** The text is handed to the file whenever this much of it has been generated */
+            size_t            buffer_size    = 64 * 1024;
+         };
 
          static ostream& to_stream( ostream& out, const std::string& );
          static ostream& to_stream( ostream& out, const variant& v, output_formatting format = stringify_large_ints_and_doubles, uint32_t max_depth = DEFAULT_MAX_RECURSION_DEPTH );
@@ -44,16 +62,32 @@ namespace fc
          static variants variants_from_string( const string& utf8_str, parse_type ptype = legacy_parser, uint32_t max_depth = DEFAULT_MAX_RECURSION_DEPTH );
          static string   to_string( const variant& v, output_formatting format = stringify_large_ints_and_doubles, uint32_t max_depth = DEFAULT_MAX_RECURSION_DEPTH );
          static string   to_pretty_string( const variant& v, output_formatting format = stringify_large_ints_and_doubles, uint32_t max_depth = DEFAULT_MAX_RECURSION_DEPTH );
+         /** Appends the JSON text of @p v to @p out, a buffer reused across calls saves reallocating it */
+         static void     append_to_string( std::string& out, const variant& v, output_formatting format = stringify_large_ints_and_doubles,
+                                           uint32_t max_depth = DEFAULT_MAX_RECURSION_DEPTH, bool pretty = false );
 
          static bool     is_valid( const std::string& json_str, parse_type ptype = legacy_parser, uint32_t max_depth = DEFAULT_MAX_RECURSION_DEPTH );
 
          template<typename T>
          static void     save_to_file( const T& v, const fc::path& fi, bool pretty = true, output_formatting format = stringify_large_ints_and_doubles, uint32_t max_depth = DEFAULT_MAX_RECURSION_DEPTH )
          {
-            save_to_file( variant(v, max_depth), fi, pretty, format, max_depth );
+            save_options opts;
+            opts.pretty = pretty;
+            opts.format = format;
+            opts.max_depth = max_depth;
+            save_to_file( v, fi, opts );
          }
 
          static void     save_to_file( const variant& v, const fc::path& fi, bool pretty = true, output_formatting format = stringify_large_ints_and_doubles, uint32_t max_depth = DEFAULT_MAX_RECURSION_DEPTH );
+
+         /**
+          *  Streams the JSON text of @p v to @p fi through a buffer of opts.buffer_size bytes,
+          *  the whole text is never held in memory.  Without atomic_replace a failed save
+          *  leaves a partial file behind, with it the previous file stays untouched.
+          */
+         template<typename T>
+         static void     save_to_file( const T& v, const fc::path& fi, const save_options& opts );
+         static void     save_to_file( const variant& v, const fc::path& fi, const save_options& opts );
          static variant  from_file( const fc::path& p, parse_type ptype = legacy_parser, uint32_t max_depth = DEFAULT_MAX_RECURSION_DEPTH );
 
          template<typename T>
@@ -62,17 +96,12 @@ namespace fc
             return json::from_file(p, ptype, max_depth).as<T>(max_depth);
          }
 
+         /** Same output as to_string( variant( v, max_depth ) ), see json_serializer */
          template<typename T>
-         static string   to_string( const T& v, output_formatting format = stringify_large_ints_and_doubles, uint32_t max_depth = DEFAULT_MAX_RECURSION_DEPTH )
-         {
-            return to_string( variant(v, max_depth), format, max_depth );
-         }
+         static string   to_string( const T& v, output_formatting format = stringify_large_ints_and_doubles, uint32_t max_depth = DEFAULT_MAX_RECURSION_DEPTH );
 
          template<typename T>
-         static string   to_pretty_string( const T& v, output_formatting format = stringify_large_ints_and_doubles, uint32_t max_depth = DEFAULT_MAX_RECURSION_DEPTH )
-         {
-            return to_pretty_string( variant(v, max_depth), format, max_depth );
-         }
+         static string   to_pretty_string( const T& v, output_formatting format = stringify_large_ints_and_doubles, uint32_t max_depth = DEFAULT_MAX_RECURSION_DEPTH );
 
          template<typename T>
          static void save_to_file( const T& v, const std::string& p, bool pretty = true, output_formatting format = stringify_large_ints_and_doubles, uint32_t max_depth = DEFAULT_MAX_RECURSION_DEPTH )
@@ -84,3 +113,5 @@ namespace fc
 } // fc
 
 #undef DEFAULT_MAX_RECURSION_DEPTH
+
+#include <fc/io/json_writer.hpp>
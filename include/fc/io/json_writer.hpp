@@ -0,0 +1,252 @@
+#pragma once
+#include <fc/io/json.hpp>
+#include <fc/optional.hpp>
+#include <fc/reflect/reflect.hpp>
+
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace fc
+{
+   /**
+    *  Appends JSON text to a std::string, used by json::to_string() and friends.
+    *
+    *  Besides whole variants it can write objects and arrays piece by piece,
+    *  which json_serializer uses to print reflected types without converting
+    *  them to a variant first.  With pretty set the output has the layout of
+    *  json::to_pretty_string().
+    */
+   class json_writer
+   {
+      public:
+         json_writer( std::string& out, json::output_formatting format, bool pretty = false );
+         /**
+          *  Also calls @p flush whenever @p out holds at least @p flush_at bytes at the
+          *  start of an object member or array element, @p flush must empty @p out.
+          */
+         json_writer( std::string& out, json::output_formatting format, bool pretty, size_t flush_at,
+                      std::function<void()> flush );
+
+         void write( const variant& v, uint32_t max_depth );
+         /** Writes the array, its elements are written with max_depth */
+         void write( const variants& a, uint32_t max_depth );
+         /** Writes the object, its values are written with max_depth */
+         void write( const variant_object& o, uint32_t max_depth );
+         /** Writes an escaped string value */
+         void write( const std::string& str );
+
+         void begin_object();
+         /** Starts the member @p name, @p first tells if it is the first member of its object */
+         void key( const char* name, size_t size, bool first );
+         void end_object( bool empty );
+
+         void begin_array();
+         /** Starts an array element, @p first tells if it is the first element of its array */
+         void element( bool first );
+         void end_array( bool empty );
+
+      private:
+         void maybe_flush() { if( _out.size() >= _flush_at ) _flush(); }
+         void value_start();
+         void write_quoted( const char* str, size_t size );
+         void write_escape( char c );
+         void write_int( int64_t i );
+         void write_uint( uint64_t u );
+         void write_double( double d );
+         void newline();
+
+         std::string&                  _out;
+         const json::output_formatting _format;
+         const bool                    _pretty;
+         uint32_t                      _level = 0;
+         bool                          _element_newline = false; ///< pretty: a scalar element goes on a new line
+         const size_t                  _flush_at = std::numeric_limits<size_t>::max();
+         const std::function<void()>   _flush;
+   };
+
+   /**
+    *  The file end of json::save_to_file(): owns the output buffer, writes it to the
+    *  file whenever it is full and implements the atomic_replace and sync options.
+    */
+   class json_file_writer
+   {
+      public:
+         json_file_writer( const fc::path& file, const json::save_options& opts );
+         /** Closes the file, a temporary file is removed unless commit() was called */
+         ~json_file_writer();
+
+         json_file_writer( const json_file_writer& ) = delete;
+         json_file_writer& operator=( const json_file_writer& ) = delete;
+
+         json_writer& writer() { return _writer; }
+         /** Writes the rest of the buffer, syncs and closes the file and renames it over the target */
+         void commit();
+
+      private:
+         void write_buffer();
+
+         const json::save_options _opts;
+         const fc::path           _target;
+         fc::path                 _file; ///< the file being written, a temporary one for atomic_replace
+         std::FILE*               _out = nullptr;
+         bool                     _committed = false;
+         std::string              _buffer;
+         json_writer              _writer;
+   };
+
+   namespace json_detail
+   {
+      /** Converts to the depth argument of to_variant() and brings the overload below into the lookup */
+      struct depth_arg { operator uint32_t()const { return 0; } };
+      struct generic_to_variant {};
+
+      /** As good a match as the to_variant() of reflect/variant.hpp, declared only */
+      template<typename T>
+      generic_to_variant to_variant( const T&, variant&, uint32_t );
+   }
+
+   /**
+    *  Tells if some to_variant() overload other than the generic one for reflected
+    *  types handles T.  When only the generic one does, calling it together with
+    *  json_detail::to_variant() is either ambiguous or picks the latter.
+    */
+   template<typename T, typename Dummy = void>
+   struct has_custom_to_variant : std::false_type {};
+
+   template<typename T>
+   struct has_custom_to_variant<T, std::enable_if_t<!std::is_same<
+            decltype( to_variant( std::declval<const T&>(), std::declval<variant&>(), json_detail::depth_arg() ) ),
+            json_detail::generic_to_variant>::value>> : std::true_type {};
+
+   /**
+    *  Writes a T as JSON, the output is the same as writing variant( v, max_depth ).
+    *
+    *  By default it does exactly that.  Reflected types converted by the generic
+    *  to_variant(), vectors and strings are written directly, so large replies
+    *  do not need a copy of themselves as a variant tree.
+    */
+   template<typename T, typename Dummy = void>
+   struct json_serializer
+   {
+      static void write( json_writer& w, const T& v, uint32_t max_depth )
+      {
+         w.write( variant( v, max_depth ), max_depth );
+      }
+   };
+
+   template<>
+   struct json_serializer<variant>
+   {
+      static void write( json_writer& w, const variant& v, uint32_t max_depth )
+      {
+         w.write( v, max_depth );
+      }
+   };
+
+   template<>
+   struct json_serializer<std::string>
+   {
+      static void write( json_writer& w, const std::string& v, uint32_t max_depth )
+      {
+         _FC_ASSERT( max_depth > 0, "Too many nested objects!" );
+         w.write( v );
+      }
+   };
+
+   template<typename T, typename A>
+   struct json_serializer<std::vector<T,A>, std::enable_if_t<!std::is_same<T,char>::value>>
+   {
+      static void write( json_writer& w, const std::vector<T,A>& v, uint32_t max_depth )
+      {
+         _FC_ASSERT( max_depth > 0, "Recursion depth exceeded!" );
+         w.begin_array();
+         for( size_t i = 0; i < v.size(); ++i )
+         {
+            w.element( i == 0 );
+            json_serializer<T>::write( w, v[i], max_depth - 1 );
+         }
+         w.end_array( v.empty() );
+      }
+   };
+
+   /** Writes the members of a reflected type like to_variant_visitor adds them */
+   template<typename T>
+   class json_serializer_visitor
+   {
+      public:
+         json_serializer_visitor( json_writer& w, const T& v, uint32_t max_depth, bool& first )
+         :_w(w),val(v),_max_depth(max_depth - 1),_first(first) {
+            _FC_ASSERT( max_depth > 0, "Recursion depth exceeded!" );
+         }
+
+         template<typename Member, class Class, Member (Class::*member)>
+         void operator()( const char* name )const
+         {
+            this->add( name, (val.*member) );
+         }
+
+      private:
+         template<typename M>
+         void add( const char* name, const optional<M>& v )const
+         {
+            if( v.valid() )
+               add( name, *v );
+         }
+         template<typename M>
+         void add( const char* name, const M& v )const
+         {
+            _w.key( name, strlen( name ), _first );
+            _first = false;
+            json_serializer<M>::write( _w, v, _max_depth );
+         }
+
+         json_writer&   _w;
+         const T&       val;
+         const uint32_t _max_depth;
+         bool&          _first;
+   };
+
+   template<typename T>
+   struct json_serializer<T, std::enable_if_t<fc::reflector<T>::is_defined::value && !std::is_enum<T>::value
+                                              && !has_custom_to_variant<T>::value>>
+   {
+      static void write( json_writer& w, const T& v, uint32_t max_depth )
+      {
+         bool first = true;
+         w.begin_object();
+         fc::reflector<T>::visit( json_serializer_visitor<T>( w, v, max_depth, first ) );
+         w.end_object( first );
+      }
+   };
+
+   template<typename T>
+   string json::to_string( const T& v, output_formatting format, uint32_t max_depth )
+   {
+      string out;
+      json_writer w( out, format );
+      json_serializer<T>::write( w, v, max_depth );
+      return out;
+   }
+
+   template<typename T>
+   string json::to_pretty_string( const T& v, output_formatting format, uint32_t max_depth )
+   {
+      string out;
+      json_writer w( out, format, true );
+      json_serializer<T>::write( w, v, max_depth );
+      return out;
+   }
+
+   template<typename T>
+   void json::save_to_file( const T& v, const fc::path& fi, const save_options& opts )
+   {
+      json_file_writer file( fi, opts );
+      json_serializer<T>::write( file.writer(), v, opts.max_depth );
+      file.commit();
+   }
+
+} // fc
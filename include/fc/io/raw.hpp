@@ -8,6 +8,8 @@
 #include <fc/fwd.hpp>
 #include <fc/time.hpp>
 #include <fc/filesystem.hpp>
+#include <fc/interprocess/file_mapping.hpp>
+#include <fc/io/fstream.hpp>
 #include <fc/exception/exception.hpp>
 #include <fc/io/raw_fwd.hpp>
 #include <algorithm>
@@ -303,6 +305,74 @@ namespace fc {
        else v = std::string();
     }
 
+    namespace detail {
+       /** Reads a length prefix and returns the next @p size elements of @p s without copying them */
+       inline const char* unpack_view( datastream<const char*>& s, size_t elem_size, size_t& size, uint32_t _max_depth )
+       {
+          FC_ASSERT( _max_depth > 0 );
+          unsigned_int count; fc::raw::unpack( s, count, _max_depth - 1 );
+          FC_ASSERT( count.value < MAX_ARRAY_ALLOC_SIZE );
+          const size_t bytes = count.value * elem_size;
+          if( bytes > s.remaining() )
+             fc::detail::throw_datastream_range_error( "read", s.tellp() + s.remaining(),
+                                                       int64_t(bytes - s.remaining()) );
+          const char* data = s.pos();
+          s.skip( bytes );
+          size = count.value;
+          return data;
+       }
+    }
+
+    // bytes_view
+    template<typename Stream> inline void pack( Stream& s, const bytes_view& v, uint32_t _max_depth ) {
+       FC_ASSERT( _max_depth > 0 );
+       fc::raw::pack( s, unsigned_int(v.size()), _max_depth - 1 );
+       if( v.size() )
+          s.write( v.data(), v.size() );
+    }
+    inline void unpack( datastream<const char*>& s, bytes_view& v, uint32_t _max_depth ) {
+       size_t size;
+       const char* data = detail::unpack_view( s, 1, size, _max_depth );
+       v = bytes_view( data, size );
+    }
+
+    // pod_view, packed like std::vector<T>
+    template<typename Stream, typename T> inline void pack( Stream& s, const pod_view<T>& v, uint32_t _max_depth ) {
+       FC_ASSERT( _max_depth > 0 );
+       fc::raw::pack( s, unsigned_int(v.size()), _max_depth - 1 );
+       if( v.size() )
+          s.write( v.data(), v.size_bytes() );
+    }
+    template<typename T> inline void unpack( datastream<const char*>& s, pod_view<T>& v, uint32_t _max_depth ) {
+       size_t size;
+       const char* data = detail::unpack_view( s, sizeof(T), size, _max_depth );
+       v = pod_view<T>( data, size );
+    }
+
+    // string views, packed like std::string
+    template<typename Stream> inline void pack( Stream& s, const boost::string_view& v, uint32_t _max_depth ) {
+       FC_ASSERT( _max_depth > 0 );
+       fc::raw::pack( s, unsigned_int(v.size()), _max_depth - 1 );
+       if( v.size() ) s.write( v.data(), v.size() );
+    }
+    inline void unpack( datastream<const char*>& s, boost::string_view& v, uint32_t _max_depth ) {
+       size_t size;
+       const char* data = detail::unpack_view( s, 1, size, _max_depth );
+       v = boost::string_view( data, size );
+    }
+#if __cplusplus >= 201703L
+    template<typename Stream> inline void pack( Stream& s, const std::string_view& v, uint32_t _max_depth ) {
+       FC_ASSERT( _max_depth > 0 );
+       fc::raw::pack( s, unsigned_int(v.size()), _max_depth - 1 );
+       if( v.size() ) s.write( v.data(), v.size() );
+    }
+    inline void unpack( datastream<const char*>& s, std::string_view& v, uint32_t _max_depth ) {
+       size_t size;
+       const char* data = detail::unpack_view( s, 1, size, _max_depth );
+       v = std::string_view( data, size );
+    }
+#endif
+
     // bool
     template<typename Stream> inline void pack( Stream& s, const bool& v, uint32_t _max_depth )
     {
@@ -674,17 +744,68 @@ namespace fc {
        }
     }
 
+    namespace detail {
+       /** How many elements of @p elem_size bytes it is safe to allocate before reading them */
+       template<typename Stream>
+       inline uint64_t prealloc_limit( const Stream&, size_t elem_size ) {
+          return FC_MAX_PREALLOC_SIZE;
+       }
+       /** The whole vector has to be in the buffer, so allocating all of it is fine */
+       inline uint64_t prealloc_limit( const datastream<const char*>& s, size_t elem_size ) {
+          return std::max( s.remaining() / elem_size, size_t(FC_MAX_PREALLOC_SIZE) );
+       }
+
+       template<typename Stream, typename T>
+       inline void pack_vector( Stream& s, const std::vector<T>& value, uint32_t _max_depth, std::false_type ) {
+          auto itr = value.begin();
+          auto end = value.end();
+          while( itr != end ) {
+             fc::raw::pack( s, *itr, _max_depth );
+             ++itr;
+          }
+       }
+       template<typename Stream, typename T>
+       inline void pack_vector( Stream& s, const std::vector<T>& value, uint32_t _max_depth, std::true_type ) {
+          if( value.size() )
+             s.write( (const char*)value.data(), value.size() * sizeof(T) );
+       }
+
+       template<typename Stream, typename T>
+       inline void unpack_vector( Stream& s, std::vector<T>& value, uint64_t size, uint32_t _max_depth,
+                                  std::false_type ) {
+          value.resize( std::min( size, static_cast<uint64_t>(FC_MAX_PREALLOC_SIZE) ) );
+          for( uint64_t i = 0; i < size; i++ )
+          {
+             if( i >= value.size() )
+                value.resize( std::min( static_cast<uint64_t>(2*value.size()), size ) );
+             unpack( s, value[i], _max_depth );
+          }
+       }
+       /** Reads as many elements at once as have been allocated, growing the
+        *  allocation no faster than the stream delivers data */
+       template<typename Stream, typename T>
+       inline void unpack_vector( Stream& s, std::vector<T>& value, uint64_t size, uint32_t _max_depth,
+                                  std::true_type ) {
+          value.resize( std::min( size, prealloc_limit( s, sizeof(T) ) ) );
+          size_t done = 0;
+          for(;;)
+          {
+             if( value.size() > done )
+                s.read( (char*)(value.data() + done), (value.size() - done) * sizeof(T) );
+             done = value.size();
+             if( done == size )
+                break;
+             value.resize( std::min( static_cast<uint64_t>(2*done), size ) );
+          }
+       }
+    }
+
     template<typename Stream, typename T>
     inline void pack( Stream& s, const std::vector<T>& value, uint32_t _max_depth ) {
        FC_ASSERT( _max_depth > 0 );
        --_max_depth;
        fc::raw::pack( s, unsigned_int(value.size()), _max_depth );
-       auto itr = value.begin();
-       auto end = value.end();
-       while( itr != end ) {
-          fc::raw::pack( s, *itr, _max_depth );
-          ++itr;
-       }
+       detail::pack_vector( s, value, _max_depth, is_trivially_packed<T>() );
     }
 
     template<typename Stream, typename T>
@@ -692,13 +813,7 @@ namespace fc {
        FC_ASSERT( _max_depth > 0 );
        --_max_depth;
        unsigned_int size; fc::raw::unpack( s, size, _max_depth );
-       value.resize( std::min( size.value, static_cast<uint64_t>(FC_MAX_PREALLOC_SIZE) ) );
-       for( uint64_t i = 0; i < size; i++ )
-       {
-          if( i >= value.size() )
-             value.resize( std::min( static_cast<uint64_t>(2*value.size()), size.value ) );
-          unpack( s, value[i], _max_depth );
-       }
+       detail::unpack_vector( s, value, size.value, _max_depth, is_trivially_packed<T>() );
     }
 
     template<typename Stream, typename T>
@@ -776,6 +891,19 @@ namespace fc {
        return vec;
     }
 
+    /**
+     *  Packs @p v into @p buf in a single pass, replacing its contents.  Unlike
+     *  pack(v) this does not measure @p v first, so for deep objects it is
+     *  cheaper, and a buffer that is reused across calls rarely reallocates.
+     */
+    template<typename T>
+    inline void pack_to_vector( std::vector<char>& buf, const T& v, uint32_t _max_depth ) {
+       FC_ASSERT( _max_depth > 0 );
+       buf.clear();
+       datastream<std::vector<char>> ds( buf );
+       fc::raw::pack( ds, v, _max_depth - 1 );
+    }
+
     template<typename T, typename... Next>
     inline std::vector<char> pack(  const T& v, Next... next, uint32_t _max_depth ) {
        FC_ASSERT( _max_depth > 0 );
@@ -839,6 +967,39 @@ namespace fc {
        fc::raw::unpack( ds, v, _max_depth - 1 );
     } FC_RETHROW_EXCEPTIONS( warn, "error unpacking ${type}", ("type",fc::get_typename<T>::name() ) ) }
 
+    /**
+     *  Unpacks the contents of a file in place from a read-only memory mapping of it,
+     *  instead of reading the file into a buffer first. An empty file gives T(), and
+     *  files that can't be mapped, such as FIFOs, are still read into a buffer.
+     */
+    template<typename T>
+    inline T unpack_file( const fc::path& filename, uint32_t _max_depth )
+    {
+       T v;
+       fc::raw::unpack_file( filename, v, _max_depth );
+       return v;
+    }
+
+    template<typename T>
+    inline void unpack_file( const fc::path& filename, T& v, uint32_t _max_depth )
+    { try {
+       FC_ASSERT( _max_depth > 0 );
+       fc::mapped_file file( filename );
+       if( file.size() ) {
+          datastream<const char*>  ds( file.data(), file.size() );
+          fc::raw::unpack( ds, v, _max_depth - 1 );
+          return;
+       }
+       // not mapped, e.g. a FIFO
+       std::string contents;
+       fc::read_file_contents( filename, contents );
+       if( contents.size() ) {
+          datastream<const char*>  ds( contents.data(), contents.size() );
+          fc::raw::unpack( ds, v, _max_depth - 1 );
+       }
+    } FC_RETHROW_EXCEPTIONS( warn, "error unpacking ${type} from ${file}",
+                             ("type",fc::get_typename<T>::name())("file",filename) ) }
+
    template<typename Stream>
    struct pack_static_variant
    {
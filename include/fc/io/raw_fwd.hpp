@@ -1,8 +1,10 @@
 #pragma once
 #include <boost/endian/buffers.hpp>
+#include <boost/utility/string_view.hpp>
 
 #include <fc/config.hpp>
 #include <fc/container/flat_fwd.hpp>
+#include <fc/io/raw_view.hpp>
 #include <fc/io/varint.hpp>
 #include <fc/safe.hpp>
 #include <fc/uint128.hpp>
@@ -15,6 +17,10 @@
 #include <unordered_set>
 #include <unordered_map>
 #include <set>
+#include <type_traits>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
 
 #define MAX_ARRAY_ALLOC_SIZE (1024*1024*10)
 
@@ -25,6 +31,7 @@ namespace fc {
    class variant_object;
    class path;
    template<typename... Types> class static_variant;
+   template<typename T> class datastream;
 
    class sha224;
    class sha256;
@@ -37,6 +44,30 @@ namespace fc {
    namespace ecc { class public_key; class private_key; }
 
    namespace raw {
+    /**
+     *  True for types whose packed form is exactly their bytes in memory.  Vectors
+     *  of these are packed and unpacked with one bulk write or read instead of
+     *  element by element.  Specialize it next to the pack/unpack of such a type.
+     */
+    template<typename T, typename Dummy = void>
+    struct is_trivially_packed : std::false_type {};
+    /** The integer types with a pack/unpack, their size and wire format are the same everywhere */
+    template<typename T>
+    struct is_fixed_width_int : std::integral_constant<bool,
+          std::is_same<T,int8_t>::value  || std::is_same<T,uint8_t>::value
+       || std::is_same<T,int16_t>::value || std::is_same<T,uint16_t>::value
+       || std::is_same<T,int32_t>::value || std::is_same<T,uint32_t>::value
+       || std::is_same<T,int64_t>::value || std::is_same<T,uint64_t>::value> {};
+    template<typename T>
+    struct is_trivially_packed<T, std::enable_if_t<is_fixed_width_int<T>::value
+                                                   && boost::endian::order::native == boost::endian::order::little>>
+       : std::true_type {};
+    template<typename T, std::size_t N>
+    struct is_trivially_packed<boost::endian::endian_buffer<boost::endian::order::little,T,N,boost::endian::align::no>>
+       : std::true_type {};
+    template<size_t N> struct is_trivially_packed<std::array<char,N>> : std::true_type {};
+    template<size_t N> struct is_trivially_packed<std::array<unsigned char,N>> : std::true_type {};
+
     template<typename T>
     inline size_t pack_size(  const T& v );
 
@@ -155,11 +186,27 @@ namespace fc {
     template<typename Stream, typename T> inline void unpack( Stream& s, std::shared_ptr<const T>& v,
                                                               uint32_t _max_depth=FC_PACK_MAX_DEPTH );
 
+    // borrowed views can only be unpacked from a buffer they can point into
+    template<typename Stream> inline void pack( Stream& s, const bytes_view& v, uint32_t _max_depth=FC_PACK_MAX_DEPTH );
+    inline void unpack( datastream<const char*>& s, bytes_view& v, uint32_t _max_depth=FC_PACK_MAX_DEPTH );
+    template<typename Stream, typename T> inline void pack( Stream& s, const pod_view<T>& v, uint32_t _max_depth=FC_PACK_MAX_DEPTH );
+    template<typename T> inline void unpack( datastream<const char*>& s, pod_view<T>& v, uint32_t _max_depth=FC_PACK_MAX_DEPTH );
+    template<typename Stream> inline void pack( Stream& s, const boost::string_view& v, uint32_t _max_depth=FC_PACK_MAX_DEPTH );
+    inline void unpack( datastream<const char*>& s, boost::string_view& v, uint32_t _max_depth=FC_PACK_MAX_DEPTH );
+#if __cplusplus >= 201703L
+    template<typename Stream> inline void pack( Stream& s, const std::string_view& v, uint32_t _max_depth=FC_PACK_MAX_DEPTH );
+    inline void unpack( datastream<const char*>& s, std::string_view& v, uint32_t _max_depth=FC_PACK_MAX_DEPTH );
+#endif
+
     template<typename Stream> inline void pack( Stream& s, const bool& v, uint32_t _max_depth=FC_PACK_MAX_DEPTH );
     template<typename Stream> inline void unpack( Stream& s, bool& v, uint32_t _max_depth=FC_PACK_MAX_DEPTH );
 
     template<typename T> inline std::vector<char> pack( const T& v, uint32_t _max_depth=FC_PACK_MAX_DEPTH );
+    template<typename T> inline void pack_to_vector( std::vector<char>& buf, const T& v,
+                                                     uint32_t _max_depth=FC_PACK_MAX_DEPTH );
     template<typename T> inline T unpack( const std::vector<char>& s, uint32_t _max_depth=FC_PACK_MAX_DEPTH );
     template<typename T> inline T unpack( const char* d, uint32_t s, uint32_t _max_depth=FC_PACK_MAX_DEPTH );
     template<typename T> inline void unpack( const char* d, uint32_t s, T& v, uint32_t _max_depth=FC_PACK_MAX_DEPTH );
+    template<typename T> inline T unpack_file( const fc::path& filename, uint32_t _max_depth=FC_PACK_MAX_DEPTH );
+    template<typename T> inline void unpack_file( const fc::path& filename, T& v, uint32_t _max_depth=FC_PACK_MAX_DEPTH );
 } }
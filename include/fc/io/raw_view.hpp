@@ -0,0 +1,89 @@
+#pragma once
+#include <boost/endian/conversion.hpp>
+
+#include <string.h>
+#include <stdint.h>
+#include <type_traits>
+#include <vector>
+
+namespace fc { namespace raw {
+
+   /**
+    *  A read-only range of bytes that does not own its data.
+    *
+    *  It has the same packed format as std::vector<char>, but unpacking it from
+    *  a datastream<const char*> points it into the buffer of the stream instead of
+    *  copying, so it is only valid as long as that buffer is.
+    */
+   class bytes_view
+   {
+      public:
+         typedef const char* const_iterator;
+
+         bytes_view() {}
+         bytes_view( const char* data, size_t size ):_data(data),_size(size){}
+         bytes_view( const std::vector<char>& v ):_data(v.data()),_size(v.size()){}
+
+         const char*    data()const  { return _data;         }
+         size_t         size()const  { return _size;         }
+         bool           empty()const { return _size == 0;    }
+         const_iterator begin()const { return _data;         }
+         const_iterator end()const   { return _data + _size; }
+         char operator[]( size_t i )const { return _data[i]; }
+
+         std::vector<char> to_vector()const { return std::vector<char>( begin(), end() ); }
+
+         friend bool operator==( const bytes_view& a, const bytes_view& b )
+         {
+            return a._size == b._size && ( a._size == 0 || memcmp( a._data, b._data, a._size ) == 0 );
+         }
+         friend bool operator!=( const bytes_view& a, const bytes_view& b ) { return !( a == b ); }
+
+      private:
+         const char* _data = nullptr;
+         size_t      _size = 0;
+   };
+
+   /**
+    *  A read-only view of a packed std::vector<T> of integers that does not own
+    *  its data, see bytes_view.
+    *
+    *  The elements are read from the packed (little endian, unaligned) bytes
+    *  when accessed, so the view never copies the whole array.
+    */
+   template<typename T>
+   class pod_view
+   {
+      static_assert( std::is_integral<T>::value && !std::is_same<T,bool>::value,
+                     "pod_view only supports integers, they are packed as plain little endian bytes" );
+      public:
+         pod_view() {}
+         /** @param size the number of elements at data */
+         pod_view( const char* data, size_t size ):_data(data),_size(size){}
+
+         const char* data()const       { return _data;             }
+         size_t      size()const       { return _size;             }
+         size_t      size_bytes()const { return _size * sizeof(T); }
+         bool        empty()const      { return _size == 0;        }
+
+         T operator[]( size_t i )const
+         {
+            T v;
+            memcpy( &v, _data + i * sizeof(T), sizeof(T) );
+            return boost::endian::little_to_native( v );
+         }
+
+         std::vector<T> to_vector()const
+         {
+            std::vector<T> v( _size );
+            for( size_t i = 0; i < _size; ++i )
+               v[i] = (*this)[i];
+            return v;
+         }
+
+      private:
+         const char* _data = nullptr;
+         size_t      _size = 0;
+   };
+
+} } // namespace fc::raw
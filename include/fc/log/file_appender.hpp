@@ -9,6 +9,9 @@ namespace fc {
 
 class file_appender : public appender {
     public:
+         /** What log() does in async mode when the queue of the writer thread is full */
+         struct overflow { enum type { block, drop, sample }; };
+
          struct config {
             config( const fc::path& p = "log.txt" );
 
@@ -19,11 +22,22 @@ class file_appender : public appender {
             microseconds                       rotation_interval;
             microseconds                       rotation_limit;
             uint32_t                           max_object_depth = FC_MAX_LOG_OBJECT_DEPTH;
+
+            /** Hand formatted lines to a writer thread, which writes them in batches */
+            bool                               async = false;
+            uint32_t                           async_queue_size = 8192; ///< lines, rounded up to a power of 2
+            overflow::type                     async_overflow = overflow::block;
+            uint32_t                           async_sample_rate = 100; ///< sample: keep one of this many lines while full
+            /** Without flush, the longest time a line waits in the queue */
+            microseconds                       async_flush_interval = fc::milliseconds( 500 );
          };
          file_appender( const variant& args );
          ~file_appender();
          virtual void log( const log_message& m )override;
 
+         /** Lines async mode did not write because the queue was full */
+         uint64_t dropped_messages()const;
+
       private:
          class impl;
          std::unique_ptr<impl> my;
@@ -31,5 +45,7 @@ class file_appender : public appender {
 } // namespace fc
 
 #include <fc/reflect/reflect.hpp>
+FC_REFLECT_ENUM( fc::file_appender::overflow::type, (block)(drop)(sample) )
 FC_REFLECT( fc::file_appender::config,
-            (format)(filename)(flush)(rotate)(rotation_interval)(rotation_limit)(max_object_depth) )
+            (format)(filename)(flush)(rotate)(rotation_interval)(rotation_limit)(max_object_depth)
+            (async)(async_queue_size)(async_overflow)(async_sample_rate)(async_flush_interval) )
@@ -7,6 +7,8 @@
 #include <fc/network/http/connection.hpp>
 #include <fc/signals.hpp>
 
+#include <vector>
+
 namespace fc { namespace http {
    namespace detail {
       class websocket_server_impl;
@@ -48,12 +50,47 @@ namespace fc { namespace http {
 
    typedef std::function<void(const websocket_connection_ptr&)> on_connection_handler;
 
+   /** The inbound queue of one server side connection, see websocket_server_stats */
+   struct websocket_connection_stats {
+      std::string remote_endpoint;
+      uint32_t    shard           = 0;
+      uint32_t    queued_messages = 0;
+      bool        reading_paused  = false;
+   };
+
+   /**
+    *  A snapshot of how a websocket server hands received messages to the connections.
+    *
+    *  Every connection queues up to max_queued_messages messages, when its queue is full
+    *  the server stops reading from the socket until half of them are handled.  Queued
+    *  messages are passed to websocket_connection::on_message() by at most max_workers
+    *  tasks per shard, the connections of a shard take turns one message at a time.
+    */
+   struct websocket_server_stats {
+      uint32_t shards              = 0;
+      uint32_t max_queued_messages = 0;
+      uint32_t max_workers         = 0;
+      uint32_t workers             = 0; ///< dispatch tasks running, summed over all shards
+      uint32_t busy_workers        = 0; ///< dispatch tasks inside on_message(), summed over all shards
+      uint32_t queued_messages     = 0; ///< summed over all connections
+      uint64_t dispatched_messages = 0;
+      uint64_t read_pauses         = 0; ///< times a full queue stopped reading from a socket
+      uint64_t dropped_messages    = 0; ///< queued messages discarded because their connection closed
+      std::vector<websocket_connection_stats> connections;
+   };
+
    // TODO websocket_tls_server and websocket_server have almost the same interface and implementation,
    //      better refactor to remove duplicate code and to avoid undesired or unnecessary differences
+   /**
+    *  Accepted connections are spread over shard_count fc::threads, a new connection goes
+    *  to the shard with the fewest connections.  The handlers of a connection, including
+    *  on_connection(), run on the thread of its shard.  The first shard is the thread that
+    *  creates the server, so with one shard everything runs there.
+    */
    class websocket_server
    {
       public:
-         websocket_server(const std::string& forward_header_key);
+         websocket_server( const std::string& forward_header_key, uint32_t shard_count = 1 );
          ~websocket_server();
 
          void on_connection( const on_connection_handler& handler);
@@ -65,6 +102,15 @@ namespace fc { namespace http {
          void stop_listening();
          void close();
 
+         /**
+          *  Sets how many received messages a connection may queue before the server stops
+          *  reading from it, and how many messages are handled at the same time.  Note that
+          *  a handler waiting for another message, E.G. the reply to a callback, keeps its
+          *  worker busy meanwhile, so max_workers must be larger than the number of such waits.
+          */
+         void set_inbound_limits( uint32_t max_queued_messages, uint32_t max_workers );
+         websocket_server_stats get_stats()const;
+
       private:
          friend class detail::websocket_server_impl;
          std::unique_ptr<detail::websocket_server_impl> my;
@@ -76,9 +122,11 @@ namespace fc { namespace http {
    class websocket_tls_server
    {
       public:
+         /** See websocket_server for shard_count */
          websocket_tls_server( const std::string& server_pem,
                                const std::string& ssl_password,
-                               const std::string& forward_header_key );
+                               const std::string& forward_header_key,
+                               uint32_t shard_count = 1 );
          ~websocket_tls_server();
 
          void on_connection( const on_connection_handler& handler);
@@ -90,6 +138,10 @@ namespace fc { namespace http {
          void stop_listening();
          void close();
 
+         /** See websocket_server::set_inbound_limits() */
+         void set_inbound_limits( uint32_t max_queued_messages, uint32_t max_workers );
+         websocket_server_stats get_stats()const;
+
       private:
          friend class detail::websocket_tls_server_impl;
          std::unique_ptr<detail::websocket_tls_server_impl> my;
@@ -114,3 +166,9 @@ namespace fc { namespace http {
    };
 
 } }
+
+#include <fc/reflect/reflect.hpp>
+FC_REFLECT( fc::http::websocket_connection_stats, (remote_endpoint)(shard)(queued_messages)(reading_paused) )
+FC_REFLECT( fc::http::websocket_server_stats, (shards)(max_queued_messages)(max_workers)(workers)(busy_workers)
+                                              (queued_messages)(dispatched_messages)(read_pauses)
+                                              (dropped_messages)(connections) )
@@ -57,8 +57,8 @@ namespace fc {
       class impl;
       fc::fwd<impl,
         sizeof(void* /*vtable*/) +
-        sizeof(fc::future<size_t>) +
-        sizeof(fc::future<size_t>) +
+        sizeof(fc::asio::operation_completion) +
+        sizeof(fc::asio::operation_completion) +
         sizeof(boost::asio::ip::tcp::socket) +
         sizeof(tcp_socket_io_hooks*)
       > my;
@@ -3,13 +3,23 @@
 
 namespace fc
 {
+  namespace asio { class operation_completion; }
+
+  /**
+   *  Performs the reads and writes of a tcp_socket.  The socket passes in its own
+   *  completion for each direction, to complete operations that have to wait with.
+   */
   class tcp_socket_io_hooks
   {
   public:
     virtual ~tcp_socket_io_hooks() {}
-    virtual size_t readsome(boost::asio::ip::tcp::socket& socket, char* buffer, size_t length) = 0;
-    virtual size_t readsome(boost::asio::ip::tcp::socket& socket, const std::shared_ptr<char>& buffer, size_t length, size_t offset) = 0;
-    virtual size_t writesome(boost::asio::ip::tcp::socket& socket, const char* buffer, size_t length) = 0;
-    virtual size_t writesome(boost::asio::ip::tcp::socket& socket, const std::shared_ptr<const char>& buffer, size_t length, size_t offset) = 0;
+    virtual size_t readsome(boost::asio::ip::tcp::socket& socket, char* buffer, size_t length,
+                            asio::operation_completion& completion) = 0;
+    virtual size_t readsome(boost::asio::ip::tcp::socket& socket, const std::shared_ptr<char>& buffer, size_t length, size_t offset,
+                            asio::operation_completion& completion) = 0;
+    virtual size_t writesome(boost::asio::ip::tcp::socket& socket, const char* buffer, size_t length,
+                             asio::operation_completion& completion) = 0;
+    virtual size_t writesome(boost::asio::ip::tcp::socket& socket, const std::shared_ptr<const char>& buffer, size_t length, size_t offset,
+                             asio::operation_completion& completion) = 0;
   };
 } // namesapce fc
@@ -302,8 +302,11 @@ template<typename T> struct wrapper { using type = T; };
 template<typename... Types, typename Callable, typename = std::enable_if_t<impl::length<Types...>::value != 0>,
          typename Return = decltype(std::declval<Callable>()(wrapper<at<list<Types...>, 0>>()))>
 Return dispatch(list<Types...>, std::size_t index, Callable c) {
-   static std::function<Return(Callable&)> call_table[] =
-      { impl::dispatch_helper<Callable, Return, wrapper<Types>>... };
+   // A constant table of plain function pointers: no guard for its initialization, and each
+   // entry is an instantiation of the callable for one type, which the compiler can inline
+   using function_type = Return(*)(Callable&);
+   static constexpr function_type call_table[] =
+      { &impl::dispatch_helper<Callable, Return, wrapper<Types>>... };
    if (index < impl::length<Types...>::value) return call_table[index](c);
    throw std::out_of_range("Invalid index to fc::typelist::runtime::dispatch()");
 }
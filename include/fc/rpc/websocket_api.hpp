@@ -23,13 +23,35 @@ namespace fc { namespace rpc {
             uint64_t callback_id,
             variants args = variants() ) override;
 
+         /**
+          *  Lets the requests of a JSON-RPC batch for which @p is_read_only returns true
+          *  run concurrently with the read-only requests next to them, each in its own
+          *  task on this thread, so that calls which wait overlap.  The other requests
+          *  of a batch run one at a time in order, after the ones before them finished.
+          */
+         void set_batch_read_only_filter( std::function<bool(const request&)> is_read_only );
+
       protected:
-         response on_message( const std::string& message );
+         /**
+          *  Handles a message, a request or response object or a JSON-RPC 2.0 batch of them.
+          *  @param http_status set to the HTTP status of the reply
+          *  @return the text of the reply, empty if none is due
+          */
+         std::string on_message( const std::string& message, int& http_status );
+         /** Handles one request or response object */
+         response    on_single_message( const variant& message );
+         /** @return the replies due to the elements of a batch, in their order */
+         std::vector<response> on_batch( const variants& batch );
          response on_request( const variant& message );
          void     on_response( const variant& message );
 
          std::shared_ptr<fc::http::websocket_connection>  _connection;
          fc::rpc::state                                   _rpc_state;
+
+      private:
+         std::string reply_text( const response& reply, int& http_status )const;
+
+         std::function<bool(const request&)>              _is_read_only;
    };
 
 } } // namespace fc::rpc
@@ -12,30 +12,64 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 #include <functional>
+#include <initializer_list>
 #include <stdexcept>
+#include <type_traits>
 #include <typeinfo>
 
+#include <fc/config.hpp>
 #include <fc/exception/exception.hpp>
 
 namespace fc {
 
+/**
+ * Whether static_variant stores a T inside itself (the default for types up to
+ * FC_STATIC_VARIANT_MAX_INLINE_SIZE bytes) or allocates it on the heap. Specialize it as
+ * std::false_type to keep a type on the heap, e.g. a large alternative that is rarely used,
+ * or one that is still incomplete where the static_variant is instantiated.
+ */
+template<typename T>
+struct static_variant_inline_storage
+   : std::integral_constant<bool, sizeof(T) <= FC_STATIC_VARIANT_MAX_INLINE_SIZE
+                                  && alignof(T) <= alignof(std::max_align_t)> {};
+
 // Implementation details, the user should not import this:
 namespace impl {
 
-class dynamic_storage
+constexpr size_t static_variant_max( std::initializer_list<size_t> values )
 {
-    char* storage;
-public:
-    dynamic_storage();
-
-    ~dynamic_storage();
+    size_t m = 0;
+    for( size_t v : values )
+        if( v > m )
+            m = v;
+    return m;
+}
+
+/** Constructs, finds and destroys a T in the storage of a static_variant */
+template<typename T, bool Inline = static_variant_inline_storage<T>::value>
+struct static_variant_storage
+{
+    static constexpr size_t size = sizeof(T);
+    static constexpr size_t align = alignof(T);
 
-    void* data() const;
+    template<typename... Args>
+    static void construct( void* storage, Args&&... args ) { new(storage) T( std::forward<Args>(args)... ); }
+    static void* get( void* storage ) { return storage; }
+    static void destroy( void* storage ) { reinterpret_cast<T*>(storage)->~T(); }
+};
 
-    void alloc( size_t size );
+template<typename T>
+struct static_variant_storage<T, false>
+{
+    static constexpr size_t size = sizeof(T*);
+    static constexpr size_t align = alignof(T*);
 
-    void release();
+    template<typename... Args>
+    static void construct( void* storage, Args&&... args ) { *reinterpret_cast<T**>(storage) = new T( std::forward<Args>(args)... ); }
+    static void* get( void* storage ) { return *reinterpret_cast<T**>(storage); }
+    static void destroy( void* storage ) { delete *reinterpret_cast<T**>(storage); }
 };
 
 } // namespace impl
@@ -56,20 +90,25 @@ protected:
     using type_in_typelist = std::enable_if_t<typelist::index_of<list, X>() != -1>;
 
     tag_type _tag;
-    impl::dynamic_storage storage;
+    /** Holds the value, or a pointer to it for types that are not stored inline */
+    typename std::aligned_storage< impl::static_variant_max( { impl::static_variant_storage<Types>::size... } ),
+                                   impl::static_variant_max( { impl::static_variant_storage<Types>::align... } )
+                                 >::type storage;
+
+    void* storage_address() const {
+        return const_cast<void*>( static_cast<const void*>( &storage ) );
+    }
 
     template<typename X, typename = type_in_typelist<X>>
     void init(const X& x) {
+        impl::static_variant_storage<X>::construct( &storage, x );
         _tag = typelist::index_of<list, X>();
-        storage.alloc( sizeof(X) );
-        new(storage.data()) X(x);
     }
 
     template<typename X, typename = type_in_typelist<X>>
     void init(X&& x) {
+        impl::static_variant_storage<X>::construct( &storage, std::move(x) );
         _tag = typelist::index_of<list, X>();
-        storage.alloc( sizeof(X) );
-        new(storage.data()) X( std::move(x) );
     }
 
     void init_from_tag(tag_type tag)
@@ -78,21 +117,54 @@ protected:
         FC_ASSERT( static_cast<size_t>(tag) < count(),
                    "Unable to init with tag '${tag}' when the number of supported tags is ${count}",
                    ("tag",tag) ("count",count()) );
-        _tag = tag;
         typelist::runtime::dispatch(list(), tag, [this](auto t) {
-            using T = typename decltype(t)::type;
-            storage.alloc(sizeof(T));
-            new(reinterpret_cast<T*>(storage.data())) T();
+            impl::static_variant_storage<typename decltype(t)::type>::construct( &storage );
         });
+        _tag = tag;
+    }
+
+    /** Replaces the value with the one init constructs; if init throws, the value is a default alternative 0 */
+    template<typename Init>
+    void reinit( Init&& init )
+    {
+        clean();
+        try
+        {
+            init();
+        }
+        catch( ... )
+        {
+            init_default();
+            throw;
+        }
+    }
+
+    /** Leaves a valid value behind after a failed reinit, the tag still names the destroyed one */
+    void init_default() noexcept
+    {
+        init_from_tag(0);
     }
 
     void clean()
     {
-        typelist::runtime::dispatch(list(), _tag, [data=storage.data()](auto t) {
+        typelist::runtime::dispatch(list(), _tag, [this](auto t) {
+            impl::static_variant_storage<typename decltype(t)::type>::destroy( &storage );
+        });
+    }
+
+    /** Calls v with the value of sv, finding the value and calling v in a single dispatch on the tag */
+    template<typename Visitor, typename Self>
+    static auto visit_value( Self& sv, Visitor v )
+    {
+        FC_ASSERT( sv._tag >= 0 && static_cast<size_t>(sv._tag) < count(),
+                   "Unsupported type '${tag}', the number of supported types is ${count}! ",
+                   ("tag",sv._tag) ("count",count()) );
+        void* storage = sv.storage_address();
+        return typelist::runtime::dispatch(list(), sv._tag, [&v, storage](auto t) {
             using T = typename decltype(t)::type;
-            reinterpret_cast<T*>(data)->~T();
+            using value_type = std::conditional_t<std::is_const<Self>::value, const T, T>;
+            return v( *reinterpret_cast<value_type*>( impl::static_variant_storage<T>::get( storage ) ) );
         });
-        storage.release();
     }
 
     template<typename T, typename = void>
@@ -200,26 +272,27 @@ public:
 
     template<typename X, typename = type_in_typelist<X>>
     static_variant& operator=(const X& v) {
-        clean();
-        init(v);
+        reinit( [this, &v]() { this->init(v); } );
         return *this;
     }
     static_variant& operator=( const static_variant& v )
     {
        if( this == &v ) return *this;
-       clean();
-       typelist::runtime::dispatch(list(), v.which(), [this, &v](auto t)mutable {
-          this->init(v.template get<typename decltype(t)::type>());
-       });
+       reinit( [this, &v]() {
+          typelist::runtime::dispatch(list(), v.which(), [this, &v](auto t)mutable {
+             this->init(v.template get<typename decltype(t)::type>());
+          });
+       } );
        return *this;
     }
     static_variant& operator=( static_variant&& v )
     {
        if( this == &v ) return *this;
-       clean();
-       typelist::runtime::dispatch(list(), v.which(), [this, &v](auto t)mutable {
-          this->init(std::move(v.template get<typename decltype(t)::type>()));
-       });
+       reinit( [this, &v]() {
+          typelist::runtime::dispatch(list(), v.which(), [this, &v](auto t)mutable {
+             this->init(std::move(v.template get<typename decltype(t)::type>()));
+          });
+       } );
        return *this;
     }
 
@@ -235,7 +308,7 @@ public:
     template<typename X, typename = type_in_typelist<X>>
     X& get() {
         if(_tag == typelist::index_of<list, X>()) {
-            return *reinterpret_cast<X*>(storage.data());
+            return *reinterpret_cast<X*>( impl::static_variant_storage<X>::get( storage_address() ) );
         } else {
             FC_THROW_EXCEPTION( fc::assert_exception,
                                 "static_variant does not contain a value of type ${t}",
@@ -245,7 +318,7 @@ public:
     template<typename X, typename = type_in_typelist<X>>
     const X& get() const {
         if(_tag == typelist::index_of<list, X>()) {
-            return *reinterpret_cast<const X*>(storage.data());
+            return *reinterpret_cast<const X*>( impl::static_variant_storage<X>::get( storage_address() ) );
         } else {
             FC_THROW_EXCEPTION( fc::assert_exception,
                                 "static_variant does not contain a value of type ${t}",
@@ -254,22 +327,22 @@ public:
     }
     template<typename visitor>
     auto visit(visitor& v) {
-        return visit( _tag, v, (void*) storage.data() );
+        return visit_value<visitor&, static_variant>( *this, v );
     }
 
     template<typename visitor>
     auto visit(const visitor& v) {
-        return visit( _tag, v, (void*) storage.data() );
+        return visit_value<const visitor&, static_variant>( *this, v );
     }
 
     template<typename visitor>
     auto visit(visitor& v)const {
-        return visit( _tag, v, (const void*) storage.data() );
+        return visit_value<visitor&, const static_variant>( *this, v );
     }
 
     template<typename visitor>
     auto visit(const visitor& v)const {
-        return visit( _tag, v, (const void*) storage.data() );
+        return visit_value<const visitor&, const static_variant>( *this, v );
     }
 
     template<typename visitor>
@@ -322,8 +395,7 @@ public:
       FC_ASSERT( static_cast<size_t>(tag) < count(),
                  "Unable to set tag '${tag}' when the number of supported tags is ${count}",
                  ("tag",tag) ("count",count()) );
-      clean();
-      init_from_tag(tag);
+      reinit( [this, tag]() { this->init_from_tag(tag); } );
     }
 
     tag_type which() const {return _tag;}
@@ -81,6 +81,8 @@ namespace fc {
       void _set_value(const void* v);
 
       void _on_complete( detail::completion_handler* c );
+      /** Makes a completed promise unset again so that it can be reused, @pre nothing else refers to it */
+      void _reset();
 
     private:
       void _enqueue_thread();
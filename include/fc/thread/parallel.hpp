@@ -28,8 +28,13 @@
 #include <fc/thread/thread.hpp>
 #include <fc/asio.hpp>
 
+#include <boost/exception/diagnostic_information.hpp>
+
 #include <boost/atomic/atomic.hpp>
 
+#include <algorithm>
+#include <iterator>
+
 namespace fc {
 
    namespace detail {
@@ -40,6 +45,7 @@ namespace fc {
          worker_pool();
          ~worker_pool();
          void post( task_base* task );
+         uint16_t num_threads()const;
       private:
           pool_impl*    my;
       };
@@ -105,4 +111,158 @@ namespace fc {
       detail::get_worker_pool().post( tsk.get() );
       return r;
    }
+
+   namespace detail {
+      /** Shared state of a parallel_for call over the indices [0, count). The
+       *  indices are cut into chunks of <code>grain</code>, and a few pool tasks
+       *  (at most one per worker) keep claiming chunks until none are left. This
+       *  is the only allocation besides those tasks, regardless of count.
+       */
+      template<typename Functor>
+      class parallel_for_state : public std::enable_shared_from_this< parallel_for_state<Functor> >
+      {
+      public:
+         parallel_for_state( size_t count, size_t grain, Functor&& f, const char* desc )
+            : count( count ), grain( grain ), chunks( (count + grain - 1) / grain ),
+              func( std::forward<Functor>(f) ), result( promise<void>::create( desc ) ),
+              next_chunk( 0 ), pending_tasks( 0 ), failed( false ) {}
+
+         future<void> start( const char* desc )
+         {
+            future<void> r( result );
+            if( chunks == 0 )
+            {
+               result->set_value();
+               return r;
+            }
+            const uint32_t num_tasks = std::min<size_t>( chunks, std::max<uint16_t>( 1, get_worker_pool().num_threads() ) );
+            pending_tasks.store( num_tasks );
+            auto self = this->shared_from_this();
+            for( uint32_t i = 0; i < num_tasks; i++ )
+               do_parallel( [self] () { self->run(); }, desc );
+            return r;
+         }
+
+      private:
+         void run()
+         {
+            try
+            {
+               for( size_t c = next_chunk.fetch_add( 1 ); c < chunks && !failed.load( boost::memory_order_relaxed );
+                    c = next_chunk.fetch_add( 1 ) )
+               {
+                  const size_t end = std::min( count, (c + 1) * grain );
+                  for( size_t i = c * grain; i < end; ++i )
+                     func( i );
+               }
+            }
+            catch( const fc::exception& e )
+            {
+               fail( e.dynamic_copy_exception() );
+            }
+            catch( ... )
+            {
+               fail( std::make_shared<unhandled_exception>( FC_LOG_MESSAGE( warn, "unhandled exception in parallel_for: ${diagnostic}",
+                                                                            ("diagnostic",boost::current_exception_diagnostic_information()) ) ) );
+            }
+
+            if( pending_tasks.fetch_sub( 1 ) == 1 )
+            {
+               if( error )
+                  result->set_exception( error );
+               else
+                  result->set_value();
+            }
+         }
+
+         void fail( const fc::exception_ptr& e )
+         {
+            if( !failed.exchange( true ) )
+               error = e; // only the first exception is kept, published by pending_tasks
+         }
+
+         const size_t             count;
+         const size_t             grain;
+         const size_t             chunks;
+         Functor                  func;
+         promise<void>::ptr       result;
+         fc::exception_ptr        error;
+         boost::atomic<size_t>    next_chunk;
+         boost::atomic<uint32_t>  pending_tasks;
+         boost::atomic<bool>      failed;
+      };
+
+      /** @return grain, or a grain size that gives every worker a few chunks if grain is 0 */
+      inline size_t parallel_grain( size_t count, size_t grain )
+      {
+         if( grain > 0 )
+            return grain;
+         return std::max<size_t>( 1, count / ( 4 * std::max<uint16_t>( 1, get_worker_pool().num_threads() ) ) );
+      }
+
+      template<typename Functor>
+      future<void> start_parallel_for( size_t count, size_t grain, Functor&& f, const char* desc )
+      {
+         auto state = std::make_shared< parallel_for_state<Functor> >( count, parallel_grain( count, grain ),
+                                                                       std::forward<Functor>(f), desc );
+         return state->start( desc );
+      }
+   }
+
+   /**
+    *  Calls <code>f(*i)</code> for every i in [first, last) using the worker pool,
+    *  and returns a single future that completes when all calls have finished.
+    *  If any call throws, the future carries the first exception and chunks that
+    *  haven't started yet are skipped.
+    *
+    *  The caller must keep the range alive until the future is ready.  The worker
+    *  threads share one copy of f and call it concurrently, so a functor whose
+    *  <code>operator()</code> is not const must synchronize any state it changes.
+    *
+    *  @param first start of a random-access range
+    *  @param last end of the range
+    *  @param f the operation to perform on each element
+    *  @param grain number of consecutive elements processed per chunk, 0 for automatic
+    *  @param desc task name
+    */
+   template<typename Iterator, typename Functor>
+   future<void> parallel_for( Iterator first, Iterator last, Functor&& f, size_t grain = 0,
+                              const char* desc FC_TASK_NAME_DEFAULT_ARG )
+   {
+      return detail::start_parallel_for( std::distance( first, last ), grain,
+                                         [first,f] ( size_t i ) mutable { f( first[i] ); }, desc );
+   }
+
+   /** Calls <code>f(e)</code> for every element e of range, @see parallel_for above */
+   template<typename Range, typename Functor>
+   future<void> parallel_for( Range& range, Functor&& f, size_t grain = 0, const char* desc FC_TASK_NAME_DEFAULT_ARG )
+   {
+      return parallel_for( std::begin(range), std::end(range), std::forward<Functor>(f), grain, desc );
+   }
+
+   /**
+    *  Stores <code>f(*i)</code> in the corresponding element of the output range
+    *  for every i in [first, last) using the worker pool. The output range must
+    *  already hold at least as many elements as the input range.
+    *  @see parallel_for
+    *
+    *  @param out start of a random-access output range
+    */
+   template<typename InIterator, typename OutIterator, typename Functor>
+   future<void> parallel_transform( InIterator first, InIterator last, OutIterator out, Functor&& f, size_t grain = 0,
+                                    const char* desc FC_TASK_NAME_DEFAULT_ARG )
+   {
+      return detail::start_parallel_for( std::distance( first, last ), grain,
+                                         [first,out,f] ( size_t i ) mutable { out[i] = f( first[i] ); }, desc );
+   }
+
+   /** Transforms every element of in into the corresponding element of out, @see parallel_transform above */
+   template<typename InRange, typename OutRange, typename Functor>
+   future<void> parallel_transform( const InRange& in, OutRange& out, Functor&& f, size_t grain = 0,
+                                    const char* desc FC_TASK_NAME_DEFAULT_ARG )
+   {
+      FC_ASSERT( std::distance( std::begin(out), std::end(out) ) >= std::distance( std::begin(in), std::end(in) ),
+                 "Output range is too small" );
+      return parallel_transform( std::begin(in), std::end(in), std::begin(out), std::forward<Functor>(f), grain, desc );
+   }
 }
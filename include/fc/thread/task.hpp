@@ -10,6 +10,16 @@ namespace fc {
   struct context;
   class spin_lock;
 
+  /**
+   *  The size of the fiber stack a task needs, see thread::async().  A task
+   *  only runs on a fiber whose stack is at least as large as it asked for.
+   */
+  enum class stack_size_class : uint8_t {
+     compact, ///< FC_CONTEXT_SMALL_STACK_SIZE, for shallow tasks spawned in large numbers
+     normal,  ///< FC_CONTEXT_STACK_SIZE
+     large    ///< FC_CONTEXT_LARGE_STACK_SIZE, for deep recursion
+  };
+
    namespace detail
    {
       struct specific_data_info
@@ -60,6 +70,10 @@ namespace fc {
       uint64_t    _posted_num;
       priority    _prio;
       time_point  _when;
+      time_point  _create_time; ///< for the task latency in thread::get_stats()
+      stack_size_class _stack_class;
+      size_t      _sch_index;    ///< position in the scheduled task heap of _scheduled_in, or size_t(-1)
+      thread*     _scheduled_in; ///< thread this task was scheduled on, if it was given a start time
       void        _set_active_context(context*);
       context*    _active_context;
       task_base*  _next;
@@ -1,6 +1,12 @@
 #pragma once
 
 #define FC_CONTEXT_STACK_SIZE (2048*1024)
+#ifndef FC_CONTEXT_SMALL_STACK_SIZE
+#define FC_CONTEXT_SMALL_STACK_SIZE (256*1024)
+#endif
+#ifndef FC_CONTEXT_LARGE_STACK_SIZE
+#define FC_CONTEXT_LARGE_STACK_SIZE (8192*1024)
+#endif
 
 #include <fc/thread/task.hpp>
 
@@ -36,6 +42,15 @@ namespace fc {
       virtual void busy() = 0;
    };
 
+   /** Counters of the fiber stack pool of a thread, see thread::get_stack_pool_stats() */
+   struct stack_pool_stats {
+      uint64_t hits   = 0; ///< fibers started on a stack taken from the pool
+      uint64_t misses = 0; ///< fibers that needed a newly mapped stack
+      uint32_t cached = 0; ///< unused stacks the pool holds right now
+   };
+
+   struct thread_stats;
+
   class thread {
     public:
       thread( const std::string& name = "", thread_idle_notifier* notifier = 0 );
@@ -82,13 +97,16 @@ namespace fc {
        *
        *  @param f the operation to perform
        *  @param prio the priority relative to other tasks
+       *  @param stack the size of the fiber stack <code>f</code> needs
        */
       template<typename Functor>
-      auto async( Functor&& f, const char* desc FC_TASK_NAME_DEFAULT_ARG, priority prio = priority()) -> fc::future<decltype(f())> {
+      auto async( Functor&& f, const char* desc FC_TASK_NAME_DEFAULT_ARG, priority prio = priority(),
+                  stack_size_class stack = stack_size_class::normal ) -> fc::future<decltype(f())> {
          typedef decltype(f()) Result;
          typedef typename std::remove_const_t< std::remove_reference_t<Functor> > FunctorType;
          typename task<Result,sizeof(FunctorType)>::ptr tsk = 
               task<Result,sizeof(FunctorType)>::create( std::forward<Functor>(f), desc );
+         tsk->_stack_class = stack;
          tsk->retain(); // HERE BE DRAGONS
          fc::future<Result> r( std::dynamic_pointer_cast< promise<Result> >(tsk) );
          async_task(tsk.get(),prio);
@@ -105,13 +123,16 @@ namespace fc {
        *  @param prio the priority of this method relative to others
        *  @param when determines when this call will happen, as soon as 
        *        possible after <code>when</code>
+       *  @param stack the size of the fiber stack <code>f</code> needs
        */
       template<typename Functor>
       auto schedule( Functor&& f, const fc::time_point& when, 
-                     const char* desc FC_TASK_NAME_DEFAULT_ARG, priority prio = priority()) -> fc::future<decltype(f())> {
+                     const char* desc FC_TASK_NAME_DEFAULT_ARG, priority prio = priority(),
+                     stack_size_class stack = stack_size_class::normal ) -> fc::future<decltype(f())> {
          typedef decltype(f()) Result;
          typename task<Result,sizeof(Functor)>::ptr tsk = 
               task<Result,sizeof(Functor)>::create( std::forward<Functor>(f), desc );
+         tsk->_stack_class = stack;
          tsk->retain(); // HERE BE DRAGONS
          fc::future<Result> r( std::dynamic_pointer_cast< promise<Result> >(tsk) );
          async_task(tsk.get(),prio,when);
@@ -144,6 +165,23 @@ namespace fc {
       bool is_current()const;
      
       priority current_priority()const;
+
+      /**
+       *  Sets how many parked fibers and unused stacks of class <code>c</code> this
+       *  thread keeps for reuse (16 by default), and maps <code>preallocate</code>
+       *  stacks of that class up front.  Fibers beyond the limit exit once they run
+       *  out of work and their stacks are unmapped.
+       */
+      void configure_stack_pool( stack_size_class c, uint32_t max_cached, uint32_t preallocate = 0 );
+      stack_pool_stats get_stack_pool_stats()const;
+
+      /**
+       *  Returns the scheduler counters of this thread: queue depths, context switches
+       *  and how long tasks waited to start, by task description.  Can be called from
+       *  any thread, include fc/thread/thread_stats.hpp to use the result.
+       */
+      thread_stats get_stats()const;
+
       ~thread();
 
        template<typename T1, typename T2>
@@ -186,6 +224,7 @@ namespace fc {
       void async_task( task_base* t, const priority& p, const time_point& tp );
 
       void notify_task_has_been_canceled();
+      void notify_task_has_been_canceled( task_base* t );
       void unblock(fc::context* c);
 
       class thread_d* my;
@@ -224,12 +263,14 @@ namespace fc {
    int wait_any_until( std::vector<promise_base::ptr>&& v, const time_point& tp );
 
    template<typename Functor>
-   auto async( Functor&& f, const char* desc FC_TASK_NAME_DEFAULT_ARG, priority prio = priority()) -> fc::future<decltype(f())> {
-      return fc::thread::current().async( std::forward<Functor>(f), desc, prio );
+   auto async( Functor&& f, const char* desc FC_TASK_NAME_DEFAULT_ARG, priority prio = priority(),
+               stack_size_class stack = stack_size_class::normal ) -> fc::future<decltype(f())> {
+      return fc::thread::current().async( std::forward<Functor>(f), desc, prio, stack );
    }
    template<typename Functor>
-   auto schedule( Functor&& f, const fc::time_point& t, const char* desc FC_TASK_NAME_DEFAULT_ARG, priority prio = priority()) -> fc::future<decltype(f())> {
-      return fc::thread::current().schedule( std::forward<Functor>(f), t, desc, prio );
+   auto schedule( Functor&& f, const fc::time_point& t, const char* desc FC_TASK_NAME_DEFAULT_ARG, priority prio = priority(),
+                  stack_size_class stack = stack_size_class::normal ) -> fc::future<decltype(f())> {
+      return fc::thread::current().schedule( std::forward<Functor>(f), t, desc, prio, stack );
    }
 
   /**
@@ -0,0 +1,46 @@
+#pragma once
+#include <fc/thread/thread.hpp>
+#include <fc/string.hpp>
+
+#include <vector>
+
+namespace fc {
+
+   /**
+    *  How long tasks with one description waited between being created by
+    *  async() (or, for scheduled tasks, their start time) and starting to run.
+    */
+   struct task_latency_stats {
+      /** Upper bounds of the histogram buckets in microseconds, the last bucket is unbounded */
+      static const std::vector<uint64_t>& bucket_limits();
+
+      string                desc;
+      uint64_t              count    = 0;
+      uint64_t              total_us = 0;
+      uint64_t              max_us   = 0;
+      std::vector<uint64_t> buckets; ///< one more entry than bucket_limits()
+   };
+
+   /**
+    *  A snapshot of the scheduler counters of one fc::thread, see thread::get_stats().
+    *  Queue depths are as of the last time the thread looked at its queues.
+    */
+   struct thread_stats {
+      string   name;
+      uint32_t task_queue_depth       = 0; ///< tasks ready to start (task_pqueue)
+      uint32_t scheduled_task_count   = 0; ///< tasks waiting for their start time
+      uint32_t ready_context_count    = 0; ///< started tasks ready to resume
+      uint32_t sleeping_context_count = 0; ///< started tasks sleeping or waiting with a timeout
+      uint64_t tasks_run              = 0;
+      uint64_t context_switches       = 0;
+      stack_pool_stats                stack_pool;
+      std::vector<task_latency_stats> task_latency; ///< one entry per task description
+   };
+
+} // namespace fc
+
+#include <fc/reflect/reflect.hpp>
+FC_REFLECT( fc::stack_pool_stats, (hits)(misses)(cached) )
+FC_REFLECT( fc::task_latency_stats, (desc)(count)(total_us)(max_us)(buckets) )
+FC_REFLECT( fc::thread_stats, (name)(task_queue_depth)(scheduled_task_count)(ready_context_count)
+                              (sleeping_context_count)(tasks_run)(context_switches)(stack_pool)(task_latency) )
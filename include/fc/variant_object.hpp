@@ -5,6 +5,7 @@
 namespace fc
 {
    class mutable_variant_object;
+   namespace detail { class variant_object_index; }
    
    /**
     *  @ingroup Serializable
@@ -14,8 +15,9 @@ namespace fc
     *  Keys are kept in the order they are inserted.
     *  This dictionary implements copy-on-write
     *
-    *  @note This class is not optimized for random-access on large
-    *        sets of key-value pairs.
+    *  @note find() searches small objects linearly, objects with more
+    *        entries get a hash index of their keys the first time they
+    *        are searched.
     */
    class variant_object
    {
@@ -86,6 +88,8 @@ namespace fc
 
    private:
       std::shared_ptr< std::vector< entry > > _key_value;
+      /** built by find(), shared by the copies of this object */
+      mutable std::shared_ptr< detail::variant_object_index > _index;
       friend class mutable_variant_object;
    };
    /** @ingroup Serializable */
@@ -102,8 +106,10 @@ namespace fc
    *  Keys are kept in the order they are inserted.
    *  This dictionary implements copy-on-write
    *
-   *  @note This class is not optimized for random-access on large
-   *        sets of key-value pairs.
+   *  @note find() searches small objects linearly, objects with more
+   *        entries get a hash index of their keys the first time they
+   *        are searched, which later insertions keep up to date.  Keys
+   *        must not be changed by assigning to entries through iterators.
    */
    class mutable_variant_object
    {
@@ -213,7 +219,11 @@ namespace fc
       mutable_variant_object& operator=( const mutable_variant_object& );
       mutable_variant_object& operator=( const variant_object& );
    private:
+      void index_appended();
+
       std::unique_ptr< std::vector< entry > > _key_value;
+      /** built by find(), may be shared with variant_objects until an insertion copies it */
+      mutable std::shared_ptr< detail::variant_object_index > _index;
       friend class variant_object;
    };
 
@@ -11,6 +11,21 @@ namespace fc {
   namespace asio {
     namespace detail {
 
+      fc::exception_ptr operation_error( const boost::system::error_code& ec )
+      {
+        if( ec == boost::asio::error::eof )
+          return std::make_shared<fc::eof_exception>(
+                          FC_LOG_MESSAGE( error, "${message} ",
+                                          ("message", boost::system::system_error(ec).what())) );
+        if( ec == boost::asio::error::operation_aborted )
+          return std::make_shared<fc::canceled_exception>(
+                          FC_LOG_MESSAGE( error, "${message} ",
+                                          ("message", boost::system::system_error(ec).what())) );
+        return std::make_shared<fc::exception>(
+                          FC_LOG_MESSAGE( error, "${message} ",
+                                          ("message", boost::system::system_error(ec).what())) );
+      }
+
       read_write_handler::read_write_handler(const promise<size_t>::ptr& completion_promise) :
         _completion_promise(completion_promise)
       {
@@ -21,24 +36,8 @@ namespace fc {
         // assert(false); // to detect anywhere we're not passing in a shared buffer
         if( !ec )
           _completion_promise->set_value(bytes_transferred);
-        else if( ec == boost::asio::error::eof  )
-        {
-          _completion_promise->set_exception( std::make_shared<fc::eof_exception>(
-                          FC_LOG_MESSAGE( error, "${message} ",
-                                          ("message", boost::system::system_error(ec).what())) ) );
-        }
-        else if( ec == boost::asio::error::operation_aborted )
-        {
-          _completion_promise->set_exception( std::make_shared<fc::canceled_exception>(
-                          FC_LOG_MESSAGE( error, "${message} ",
-                                          ("message", boost::system::system_error(ec).what())) ) );
-        }
         else
-        {
-          _completion_promise->set_exception( std::make_shared<fc::exception>(
-                          FC_LOG_MESSAGE( error, "${message} ",
-                                          ("message", boost::system::system_error(ec).what())) ) );
-        }
+          _completion_promise->set_exception( operation_error( ec ) );
       }
       read_write_handler_with_buffer::read_write_handler_with_buffer(const promise<size_t>::ptr& completion_promise,
                                                                      const std::shared_ptr<const char>& buffer) :
@@ -49,24 +48,43 @@ namespace fc {
       {
         if( !ec )
           _completion_promise->set_value(bytes_transferred);
-        else if( ec == boost::asio::error::eof  )
-        {
-          _completion_promise->set_exception( std::make_shared<fc::eof_exception>(
-                          FC_LOG_MESSAGE( error, "${message} ",
-                                          ("message", boost::system::system_error(ec).what())) ) );
-        }
-        else if( ec == boost::asio::error::operation_aborted )
-        {
-          _completion_promise->set_exception( std::make_shared<fc::canceled_exception>(
-                          FC_LOG_MESSAGE( error, "${message} ",
-                                          ("message", boost::system::system_error(ec).what())) ) );
-        }
         else
+          _completion_promise->set_exception( operation_error( ec ) );
+      }
+
+      reusable_promise::reusable_promise()
+      :promise_base("fc::asio::operation_completion"),promise<size_t>("fc::asio::operation_completion"){}
+
+      void reusable_promise::reset()
+      {
+        _reset();
+        result.reset();
+      }
+
+      void* reusable_promise::allocate( size_t size )
+      {
+        if( size <= operation_size && !_operation_used )
         {
-          _completion_promise->set_exception( std::make_shared<fc::exception>(
-                          FC_LOG_MESSAGE( error, "${message} ",
-                                          ("message", boost::system::system_error(ec).what())) ) );
+          _operation_used = true;
+          return &_operation;
         }
+        return ::operator new( size );
+      }
+
+      void reusable_promise::deallocate( void* p )
+      {
+        if( p == &_operation )
+          _operation_used = false;
+        else
+          ::operator delete( p );
+      }
+
+      void reusable_read_write_handler::operator()(const boost::system::error_code& ec, size_t bytes_transferred)
+      {
+        if( !ec )
+          _completion_promise->set_value(bytes_transferred);
+        else
+          _completion_promise->set_exception( operation_error( ec ) );
       }
 
         void read_write_handler_ec( promise<size_t>* p, boost::system::error_code* oec,
@@ -127,6 +145,43 @@ namespace fc {
         }
     }
 
+    std::shared_ptr<detail::reusable_promise> operation_completion::next()
+    {
+      _immediate = 0;
+      // the handler of the previous operation may still be on its way out of set_value()
+      if( _promise && _promise.use_count() == 1 && _promise->ready() )
+      {
+        std::atomic_thread_fence( std::memory_order_acquire );
+        _promise->reset();
+      }
+      else
+        _promise = std::make_shared<detail::reusable_promise>();
+      return _promise;
+    }
+
+    bool operation_completion::try_immediate()
+    {
+      if( _immediate < max_immediate )
+      {
+        ++_immediate;
+        return true;
+      }
+      _immediate = 0;
+      return false;
+    }
+
+    void operation_completion::wait_idle()
+    {
+      if( _promise && !_promise->ready() )
+        try
+        {
+          _promise->wait();
+        }
+        catch( ... )
+        {
+        }
+    }
+
     uint16_t fc::asio::default_io_service_scope::num_io_threads = 0;
 
     /***
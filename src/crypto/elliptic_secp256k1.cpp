@@ -8,7 +8,9 @@
 #include <fc/fwd_impl.hpp>
 #include <fc/exception/exception.hpp>
 #include <fc/log/logger.hpp>
+#include <fc/thread/parallel.hpp>
 
+#include <algorithm>
 #include <assert.h>
 #include <secp256k1.h>
 
@@ -171,6 +173,41 @@ namespace fc { namespace ecc {
         FC_ASSERT( pk_len == my->_key.size() );
     }
 
+    std::vector<public_key> recover_batch( const compact_signature* signatures, const fc::sha256* digests,
+                                           size_t count, bool check_canonical )
+    {
+        std::vector<public_key> keys( count );
+        // the context is only read by recovery, so all workers share it
+        const secp256k1_context_t* ctx = detail::_get_context();
+        auto recover = [ctx,signatures,digests,check_canonical,&keys] ( const compact_signature& c ) {
+            const size_t i = &c - signatures;
+            const int nV = c[0];
+            if( nV < 27 || nV >= 35 || ( check_canonical && !public_key::is_canonical( c ) ) )
+                return;
+            public_key_data& key = keys[i].my->_key;
+            int pk_len;
+            if( !secp256k1_ecdsa_recover_compact( ctx, (unsigned char*) digests[i].data(), c.data() + 1,
+                                                  key.data(), &pk_len, 1, (nV - 27) & 3 )
+                || pk_len != (int) key.size() )
+                key = empty_pub;
+        };
+
+        // below this, handing the work to the pool costs more than it saves
+        const size_t min_parallel_count = 16;
+        if( count < min_parallel_count )
+            std::for_each( signatures, signatures + count, recover );
+        else
+            fc::parallel_for( signatures, signatures + count, recover, 0, "recover_batch" ).wait();
+        return keys;
+    }
+
+    std::vector<public_key> recover_batch( const std::vector<compact_signature>& signatures,
+                                           const std::vector<fc::sha256>& digests, bool check_canonical )
+    {
+        FC_ASSERT( signatures.size() == digests.size(), "Need one digest per signature" );
+        return recover_batch( signatures.data(), digests.data(), signatures.size(), check_canonical );
+    }
+
     extended_public_key::extended_public_key( const public_key& k, const fc::sha256& c,
                                               int child, int parent, uint8_t depth )
         : public_key(k), c(c), child_num(child), parent_fp(parent), depth(depth) { }
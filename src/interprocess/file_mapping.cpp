@@ -1,6 +1,8 @@
 #include <fc/interprocess/file_mapping.hpp>
 #include <boost/interprocess/file_mapping.hpp>
 #include <boost/interprocess/mapped_region.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/filesystem.hpp>
 #include <fc/fwd_impl.hpp>
 
 namespace fc {
@@ -29,6 +31,20 @@ namespace fc {
     return my->get_address(); 
   }
 
+  bool mapped_region::advise( advice_t a )
+  {
+    typedef boost::interprocess::mapped_region region;
+    switch( a )
+    {
+      case advice_normal:     return my->advise( region::advice_normal );
+      case advice_sequential: return my->advise( region::advice_sequential );
+      case advice_random:     return my->advise( region::advice_random );
+      case advice_willneed:   return my->advise( region::advice_willneed );
+      case advice_dontneed:   return my->advise( region::advice_dontneed );
+    }
+    return false;
+  }
+
   void mapped_region::flush()
   {
     my->flush(); 
@@ -38,4 +54,28 @@ namespace fc {
   {
     return my->get_size();
   }
+
+  mapped_file::mapped_file( const fc::path& file )
+  {
+    if( !fc::exists( file ) || fc::is_directory( file ) )
+      FC_THROW_EXCEPTION( file_not_found_exception, "File '${file}' not found", ("file",file) );
+    // an empty mapping is an error, and FIFOs or devices have no size to map
+    if( !fc::is_regular_file( file ) || fc::file_size( file ) == 0 )
+      return;
+    _mapping.reset( new file_mapping( file.generic_string().c_str(), read_only ) );
+    _region.reset( new mapped_region( *_mapping, read_only ) );
+    _region->advise( mapped_region::advice_sequential );
+  }
+
+  mapped_file::~mapped_file() {}
+
+  const char* mapped_file::data()const
+  {
+    return _region ? static_cast<const char*>( _region->get_address() ) : nullptr;
+  }
+
+  size_t mapped_file::size()const
+  {
+    return _region ? _region->get_size() : 0;
+  }
 }
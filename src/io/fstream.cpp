@@ -106,12 +106,28 @@ namespace fc {
 
    void read_file_contents( const fc::path& filename, std::string& result )
    {
+      // read straight into the result, which is the only copy of the contents
       const boost::filesystem::path& bfp = filename;
       boost::filesystem::ifstream f( bfp, std::ios::in | std::ios::binary );
-      // don't use fc::stringstream here as we need something with override for << rdbuf()
-      std::stringstream ss;
-      ss << f.rdbuf();
-      result = ss.str();
+      result.clear();
+      if( !f )
+         return;
+      f.seekg( 0, std::ios::end );
+      const std::streamoff size = f.tellg();
+      f.seekg( 0, std::ios::beg );
+      if( size <= 0 )
+      {
+         // FIFOs and files like those in /proc have no size up front, stream them until eof
+         f.clear();
+         // don't use fc::stringstream here as we need something with override for << rdbuf()
+         std::stringstream ss;
+         ss << f.rdbuf();
+         result = ss.str();
+         return;
+      }
+      result.resize( size_t( size ) );
+      f.read( &result[0], size );
+      result.resize( size_t( f.gcount() ) );
    }
   
 } // namespace fc 
@@ -4,20 +4,79 @@
 #include <fc/io/buffered_iostream.hpp>
 #include <fc/io/fstream.hpp>
 #include <fc/io/sstream.hpp>
+#include <fc/interprocess/file_mapping.hpp>
 #include <fc/log/logger.hpp>
+#include <cerrno>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 
 #include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <immintrin.h>
+#endif
 
 namespace fc
 {
+    namespace detail
+    {
+       /**
+        *  Reads JSON text directly from a contiguous buffer.  It has the peek() and
+        *  get() of fc's istreams, including throwing eof_exception at the end of
+        *  the input, but without their virtual calls and per character
+        *  bookkeeping, and it lets strings be scanned in bulk.
+        */
+       class json_buffer_stream
+       {
+          public:
+             json_buffer_stream( const char* begin, const char* end ):_pos(begin),_end(end){}
+
+             char peek()const
+             {
+                if( _pos == _end )
+                   throw_eof();
+                return *_pos;
+             }
+             char get()
+             {
+                if( _pos == _end )
+                   throw_eof();
+                return *_pos++;
+             }
+
+             const char* pos()const    { return _pos;         }
+             const char* end()const    { return _end;         }
+             bool        at_end()const { return _pos == _end; }
+             void        skip_to( const char* p ) { _pos = p; }
+
+          private:
+             [[noreturn]] static void throw_eof()
+             {
+                FC_THROW_EXCEPTION( eof_exception, "end of JSON input" );
+             }
+
+             const char* _pos;
+             const char* _end;
+       };
+    }
+
     // forward declarations of provided functions
     template<typename T, json::parse_type parser_type> variant variant_from_stream( T& in, uint32_t max_depth );
     template<typename T> char parseEscape( T& in );
     template<typename T> std::string stringFromStream( T& in );
+    std::string stringFromStream( detail::json_buffer_stream& in );
     template<typename T> bool skip_white_space( T& in );
     template<typename T> std::string stringFromToken( T& in );
     template<typename T> variant_object objectFromStreamBase( T& in, std::function<std::string(T&)>& get_key, std::function<variant(T&)>& get_value );
@@ -26,11 +85,6 @@ namespace fc
     template<typename T, json::parse_type parser_type> variants arrayFromStream( T& in, uint32_t max_depth );
     template<typename T, json::parse_type parser_type> variant number_from_stream( T& in );
     template<typename T> variant token_from_stream( T& in );
-    void escape_string( const string& str, ostream& os );
-    template<typename T> void to_stream( T& os, const variants& a, json::output_formatting format, uint32_t max_depth );
-    template<typename T> void to_stream( T& os, const variant_object& o, json::output_formatting format, uint32_t max_depth );
-    template<typename T> void to_stream( T& os, const variant& v, json::output_formatting format, uint32_t max_depth );
-    std::string pretty_print( const std::string& v, uint8_t indent );
 }
 
 #if __cplusplus > 201402L
@@ -96,7 +150,7 @@ namespace fc
    template<typename T>
    std::string stringFromStream( T& in )
    {
-      fc::stringstream token;
+      std::string token;
       try
       {
          char c = in.peek();
@@ -112,28 +166,105 @@ namespace fc
             switch( c = in.peek() )
             {
                case '\\':
-                  token << parseEscape( in );
+                  token += parseEscape( in );
                   break;
                case 0x04:
                   FC_THROW_EXCEPTION( parse_error_exception, "EOF before closing '\"' in string '${token}'",
-                                                   ("token", token.str() ) );
+                                                   ("token", token ) );
                case '"':
                   in.get();
-                  return token.str();
+                  return token;
                default:
-                  token << c;
+                  token += c;
                   in.get();
             }
          }
          FC_THROW_EXCEPTION( parse_error_exception, "EOF before closing '\"' in string '${token}'",
-                                          ("token", token.str() ) );
+                                          ("token", token ) );
        } FC_RETHROW_EXCEPTIONS( warn, "while parsing token '${token}'",
-                                          ("token", token.str() ) );
+                                          ("token", token ) );
+   }
+
+   namespace detail
+   {
+      /** Returns the first '"', '\\' or ^D in [p,end), or end */
+      inline const char* find_string_special( const char* p, const char* end )
+      {
+#if defined(__AVX2__) && defined(__GNUC__)
+         const __m256i quote32     = _mm256_set1_epi8( '"' );
+         const __m256i backslash32 = _mm256_set1_epi8( '\\' );
+         const __m256i eot32       = _mm256_set1_epi8( 0x04 );
+         while( end - p >= 32 )
+         {
+            const __m256i chunk = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( p ) );
+            const __m256i hits = _mm256_or_si256( _mm256_or_si256( _mm256_cmpeq_epi8( chunk, quote32 ),
+                                                                   _mm256_cmpeq_epi8( chunk, backslash32 ) ),
+                                                  _mm256_cmpeq_epi8( chunk, eot32 ) );
+            if( const uint32_t mask = uint32_t( _mm256_movemask_epi8( hits ) ) )
+               return p + __builtin_ctz( mask );
+            p += 32;
+         }
+#endif
+#if defined(__SSE2__) && defined(__GNUC__)
+         const __m128i quote     = _mm_set1_epi8( '"' );
+         const __m128i backslash = _mm_set1_epi8( '\\' );
+         const __m128i eot       = _mm_set1_epi8( 0x04 );
+         while( end - p >= 16 )
+         {
+            const __m128i chunk = _mm_loadu_si128( reinterpret_cast<const __m128i*>( p ) );
+            const __m128i hits = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( chunk, quote ),
+                                                             _mm_cmpeq_epi8( chunk, backslash ) ),
+                                               _mm_cmpeq_epi8( chunk, eot ) );
+            if( const uint32_t mask = uint32_t( _mm_movemask_epi8( hits ) ) )
+               return p + __builtin_ctz( mask );
+            p += 16;
+         }
+#endif
+         while( p != end && *p != '"' && *p != '\\' && *p != 0x04 )
+            ++p;
+         return p;
+      }
+   }
+
+   /** Same as the generic version, but copies the runs between escapes at once */
+   std::string stringFromStream( detail::json_buffer_stream& in )
+   {
+      std::string token;
+      try
+      {
+         char c = in.peek();
+
+         if( c != '"' )
+            FC_THROW_EXCEPTION( parse_error_exception,
+                                            "Expected '\"' but read '${char}'",
+                                            ("char", string(&c, (&c) + 1) ) );
+         in.get();
+         while( true )
+         {
+            const char* run_end = detail::find_string_special( in.pos(), in.end() );
+            token.append( in.pos(), run_end );
+            in.skip_to( run_end );
+
+            switch( in.peek() )
+            {
+               case '\\':
+                  token += parseEscape( in );
+                  break;
+               case 0x04:
+                  FC_THROW_EXCEPTION( parse_error_exception, "EOF before closing '\"' in string '${token}'",
+                                                   ("token", token ) );
+               default: // '"'
+                  in.get();
+                  return token;
+            }
+         }
+       } FC_RETHROW_EXCEPTIONS( warn, "while parsing token '${token}'",
+                                          ("token", token ) );
    }
    template<typename T>
    std::string stringFromToken( T& in )
    {
-      fc::stringstream token;
+      std::string token;
       try
       {
          char c = in.peek();
@@ -143,36 +274,36 @@ namespace fc
             switch( c = in.peek() )
             {
                case '\\':
-                  token << parseEscape( in );
+                  token += parseEscape( in );
                   break;
                case '\t':
                case ' ':
                case '\0':
                case '\n':
                   in.get();
-                  return token.str();
+                  return token;
                default:
                 if( isalnum( c ) || c == '_' || c == '-' || c == '.' || c == ':' || c == '/' )
                 {
-                  token << c;
+                  token += c;
                   in.get();
                 }
-                else return token.str();
+                else return token;
             }
          }
-         return token.str();
+         return token;
       }
       catch( const fc::eof_exception& eof )
       {
-         return token.str();
+         return token;
       }
       catch (const std::ios_base::failure&)
       {
-         return token.str();
+         return token;
       }
 
       FC_RETHROW_EXCEPTIONS( warn, "while parsing token '${token}'",
-                                          ("token", token.str() ) );
+                                          ("token", token ) );
    }
 
    template<typename T>
@@ -272,14 +403,14 @@ namespace fc
    template<typename T, json::parse_type parser_type>
    variant number_from_stream( T& in )
    {
-      fc::stringstream ss;
+      std::string ss;
 
       bool  dot = false;
       bool  neg = false;
       if( in.peek() == '-')
       {
         neg = true;
-        ss.put( in.get() );
+        ss += in.get();
       }
       bool done = false;
 
@@ -306,12 +437,12 @@ namespace fc
               case '7':
               case '8':
               case '9':
-                 ss.put( in.get() );
+                 ss += in.get();
                  break;
               default:
                  if( isalnum( c ) )
                  {
-                    return ss.str() + stringFromToken( in );
+                    return ss + stringFromToken( in );
                  }
                 done = true;
                 break;
@@ -324,7 +455,7 @@ namespace fc
       catch (const std::ios_base::failure&)
       { // read error ends the loop
       }
-      std::string str = ss.str();
+      std::string str = std::move( ss );
       if (str == "-." || str == "." || str == "-") // check the obviously wrong things we could have encountered
         FC_THROW_EXCEPTION(parse_error_exception, "Can't parse token \"${token}\" as a JSON numeric constant", ("token", str));
       if( dot )
@@ -340,8 +471,7 @@ namespace fc
    template<typename T>
    variant token_from_stream( T& in )
    {
-      std::stringstream ss;
-      ss.exceptions( std::ifstream::badbit );
+      std::string ss;
       bool received_eof = false;
       bool done = false;
 
@@ -361,7 +491,7 @@ namespace fc
               case 'f':
               case 'a':
               case 's':
-                 ss.put( in.get() );
+                 ss += in.get();
                  break;
               default:
                  done = true;
@@ -380,7 +510,7 @@ namespace fc
 
       // we can get here either by processing a delimiter as in "null,"
       // an EOF like "null<EOF>", or an invalid token like "nullZ"
-      std::string str = ss.str();
+      std::string str = std::move( ss );
       if( str == "null" )
         return variant();
       if( str == "true" )
@@ -455,366 +585,555 @@ namespace fc
       }
   }
 
+   template<typename T>
+   variant parse_json_variant( T& in, json::parse_type ptype, uint32_t max_depth )
+   {
+      switch( ptype )
+      {
+          case json::legacy_parser:
+              return variant_from_stream<T, json::legacy_parser>( in, max_depth );
+#ifdef WITH_EXOTIC_JSON_PARSERS
+          case json::legacy_parser_with_string_doubles:
+              return variant_from_stream<T, json::legacy_parser_with_string_doubles>( in, max_depth );
+          case json::strict_parser:
+              return json_relaxed::variant_from_stream<T, true>( in, max_depth );
+          case json::relaxed_parser:
+              return json_relaxed::variant_from_stream<T, false>( in, max_depth );
+#endif
+          case json::broken_nul_parser:
+              return variant_from_stream<T, json::broken_nul_parser>( in, max_depth );
+          default:
+              FC_ASSERT( false, "Unknown JSON parser type {ptype}", ("ptype", ptype) );
+      }
+   }
+
    variant json::from_string( const std::string& utf8_str, parse_type ptype, uint32_t max_depth )
    { try {
-      fc::istream_ptr in( new fc::stringstream( utf8_str ) );
-      fc::buffered_istream bin( in );
-      return from_stream( bin, ptype, max_depth );
+      detail::json_buffer_stream in( utf8_str.data(), utf8_str.data() + utf8_str.size() );
+      return parse_json_variant( in, ptype, max_depth );
    } FC_RETHROW_EXCEPTIONS( warn, "", ("str",utf8_str) ) }
 
    variants json::variants_from_string( const std::string& utf8_str, parse_type ptype, uint32_t max_depth )
    {
       variants result;
       try {
-         fc::stringstream in( utf8_str );
+         detail::json_buffer_stream in( utf8_str.data(), utf8_str.data() + utf8_str.size() );
          while( true )
-            result.push_back(json_relaxed::variant_from_stream<fc::stringstream, false>( in, max_depth ));
+            result.push_back(json_relaxed::variant_from_stream<detail::json_buffer_stream, false>( in, max_depth ));
       } catch ( const fc::eof_exception& ) {
          return result;
       } FC_RETHROW_EXCEPTIONS( warn, "", ("str",utf8_str) )
    }
 
-   /**
-    *  @brief Escape a string
-    *
-    *  * A quote is added to the beginning and a quote is added to the end
-    *  * The following characters are converted specially:
-    *    @code
-    *      '\b' -> "\b"
-    *      '\f' -> "\f"
-    *      '\n' -> "\n"
-    *      '\r' -> "\r"
-    *      '\t' -> "\t"
-    *      '\\' -> "\\"
-    *      '\"' -> "\""
-    *    @endcode
-    *  * other control characters are printed as UTF8
-    *  * printable characters are printed as is
-    */
-   void escape_string( const string& str, ostream& os )
+   namespace detail
    {
-      os << '"';
-      for( auto itr = str.begin(); itr != str.end(); ++itr )
+      /** Returns the first character in [p,end) that json_writer has to escape, or end */
+      inline const char* find_escape( const char* p, const char* end )
       {
-         switch( *itr )
+#if defined(__AVX2__) && defined(__GNUC__)
+         const __m256i quote32     = _mm256_set1_epi8( '"' );
+         const __m256i backslash32 = _mm256_set1_epi8( '\\' );
+         const __m256i control32   = _mm256_set1_epi8( 0x1f );
+         while( end - p >= 32 )
+         {
+            const __m256i chunk = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( p ) );
+            // c <= 0x1f exactly when max(c, 0x1f) == 0x1f, comparing unsigned
+            const __m256i hits = _mm256_or_si256( _mm256_or_si256( _mm256_cmpeq_epi8( chunk, quote32 ),
+                                                                   _mm256_cmpeq_epi8( chunk, backslash32 ) ),
+                                                  _mm256_cmpeq_epi8( _mm256_max_epu8( chunk, control32 ), control32 ) );
+            if( const uint32_t mask = uint32_t( _mm256_movemask_epi8( hits ) ) )
+               return p + __builtin_ctz( mask );
+            p += 32;
+         }
+#endif
+#if defined(__SSE2__) && defined(__GNUC__)
+         const __m128i quote     = _mm_set1_epi8( '"' );
+         const __m128i backslash = _mm_set1_epi8( '\\' );
+         const __m128i control   = _mm_set1_epi8( 0x1f );
+         while( end - p >= 16 )
          {
-            case '\b':        // \x08
-               os << "\\b";
-               break;
-            case '\f':        // \x0c
-               os << "\\f";
-               break;
-            case '\n':        // \x0a
-               os << "\\n";
-               break;
-            case '\r':        // \x0d
-               os << "\\r";
-               break;
-            case '\t':        // \x09
-               os << "\\t";
-               break;
-            case '\\':
-               os << "\\\\";
-               break;
-            case '\"':
-               os << "\\\"";
-               break;
-            case '\x00': os << "\\u0000"; break;
-            case '\x01': os << "\\u0001"; break;
-            case '\x02': os << "\\u0002"; break;
-            case '\x03': os << "\\u0003"; break;
-            case '\x04': os << "\\u0004"; break;
-            case '\x05': os << "\\u0005"; break;
-            case '\x06': os << "\\u0006"; break;
-            case '\x07': os << "\\u0007"; break; // \a is not valid JSON
-         // case '\x08': os << "\\u0008"; break; // \b
-         // case '\x09': os << "\\u0009"; break; // \t
-         // case '\x0a': os << "\\u000a"; break; // \n
-            case '\x0b': os << "\\u000b"; break;
-         // case '\x0c': os << "\\u000c"; break; // \f
-         // case '\x0d': os << "\\u000d"; break; // \r
-            case '\x0e': os << "\\u000e"; break;
-            case '\x0f': os << "\\u000f"; break;
-
-            case '\x10': os << "\\u0010"; break;
-            case '\x11': os << "\\u0011"; break;
-            case '\x12': os << "\\u0012"; break;
-            case '\x13': os << "\\u0013"; break;
-            case '\x14': os << "\\u0014"; break;
-            case '\x15': os << "\\u0015"; break;
-            case '\x16': os << "\\u0016"; break;
-            case '\x17': os << "\\u0017"; break;
-            case '\x18': os << "\\u0018"; break;
-            case '\x19': os << "\\u0019"; break;
-            case '\x1a': os << "\\u001a"; break;
-            case '\x1b': os << "\\u001b"; break;
-            case '\x1c': os << "\\u001c"; break;
-            case '\x1d': os << "\\u001d"; break;
-            case '\x1e': os << "\\u001e"; break;
-            case '\x1f': os << "\\u001f"; break;
-
-            default:
-               os << *itr;
+            const __m128i chunk = _mm_loadu_si128( reinterpret_cast<const __m128i*>( p ) );
+            const __m128i hits = _mm_or_si128( _mm_or_si128( _mm_cmpeq_epi8( chunk, quote ),
+                                                             _mm_cmpeq_epi8( chunk, backslash ) ),
+                                               _mm_cmpeq_epi8( _mm_max_epu8( chunk, control ), control ) );
+            if( const uint32_t mask = uint32_t( _mm_movemask_epi8( hits ) ) )
+               return p + __builtin_ctz( mask );
+            p += 16;
          }
+#endif
+         while( p != end && uint8_t(*p) > 0x1f && *p != '"' && *p != '\\' )
+            ++p;
+         return p;
       }
-      os << '"';
-   }
-   ostream& json::to_stream( ostream& out, const std::string& str )
-   {
-        escape_string( str, out );
-        return out;
-   }
 
-   template<typename T>
-   void to_stream( T& os, const variants& a, json::output_formatting format, uint32_t max_depth )
-   {
-      os << '[';
-      auto itr = a.begin();
-
-      while( itr != a.end() )
-      {
-         to_stream( os, *itr, format, max_depth );
-         ++itr;
-         if( itr != a.end() )
-            os << ',';
-      }
-      os << ']';
    }
-   template<typename T>
-   void to_stream( T& os, const variant_object& o, json::output_formatting format, uint32_t max_depth )
-   {
-       os << '{';
-       auto itr = o.begin();
 
-       while( itr != o.end() )
-       {
-          escape_string( itr->key(), os );
-          os << ':';
-          to_stream( os, itr->value(), format, max_depth );
-          ++itr;
-          if( itr != o.end() )
-             os << ',';
-       }
-       os << '}';
-   }
+   json_writer::json_writer( std::string& out, json::output_formatting format, bool pretty )
+   :_out(out),_format(format),_pretty(pretty){}
 
-   template<typename T>
-   void to_stream( T& os, const variant& v, json::output_formatting format, uint32_t max_depth )
+   json_writer::json_writer( std::string& out, json::output_formatting format, bool pretty, size_t flush_at,
+                             std::function<void()> flush )
+   :_out(out),_format(format),_pretty(pretty),_flush_at(flush_at),_flush(std::move(flush)){}
+
+   void json_writer::write( const variant& v, uint32_t max_depth )
    {
       FC_ASSERT( max_depth > 0, "Too many nested objects!" );
       switch( v.get_type() )
       {
          case variant::null_type:
-              os << "null";
+              value_start();
+              _out.append( "null", 4 );
               return;
          case variant::int64_type:
-              if( format == json::stringify_large_ints_and_doubles &&
-                  ( v.as_int64() > INT32_MAX || v.as_int64() < INT32_MIN ) )
-                 os << '"'<<v.as_string()<<'"';
+         {
+              value_start();
+              const int64_t i = v.as_int64();
+              if( _format == json::stringify_large_ints_and_doubles && ( i > INT32_MAX || i < INT32_MIN ) )
+              {
+                 _out += '"';
+                 write_int( i );
+                 _out += '"';
+              }
               else
-                 os << v.as_int64();
+                 write_int( i );
               return;
+         }
          case variant::uint64_type:
-              if( format == json::stringify_large_ints_and_doubles &&
-                  v.as_uint64() > 0xffffffff )
-                 os << '"'<<v.as_string()<<'"';
+         {
+              value_start();
+              const uint64_t u = v.as_uint64();
+              if( _format == json::stringify_large_ints_and_doubles && u > 0xffffffff )
+              {
+                 _out += '"';
+                 write_uint( u );
+                 _out += '"';
+              }
               else
-                 os << v.as_uint64();
+                 write_uint( u );
               return;
+         }
          case variant::double_type:
-              if (format == json::stringify_large_ints_and_doubles)
-                 os << '"'<<v.as_string()<<'"';
+              value_start();
+              if( _format == json::stringify_large_ints_and_doubles )
+              {
+                 _out += '"';
+                 write_double( v.as_double() );
+                 _out += '"';
+              }
               else
-                 os << v.as_string();
+                 write_double( v.as_double() );
               return;
          case variant::bool_type:
-              os << v.as_string();
+              value_start();
+              if( v.as_bool() )
+                 _out.append( "true", 4 );
+              else
+                 _out.append( "false", 5 );
               return;
          case variant::string_type:
-              escape_string( v.get_string(), os );
+              write( v.get_string() );
               return;
          case variant::blob_type:
-              escape_string( v.as_string(), os );
+              write( v.as_string() );
               return;
          case variant::array_type:
-              to_stream( os, v.get_array(), format, max_depth - 1 );
+              write( v.get_array(), max_depth - 1 );
               return;
          case variant::object_type:
-              to_stream(os, v.get_object(), format, max_depth - 1 );
+              write( v.get_object(), max_depth - 1 );
               return;
          default:
             FC_THROW_EXCEPTION( fc::invalid_arg_exception, "Unsupported variant type: ${type}", ( "type", v.get_type() ) );
       }
    }
 
-   std::string   json::to_string( const variant& v, output_formatting format, uint32_t max_depth )
+   void json_writer::write( const variants& a, uint32_t max_depth )
    {
-      fc::stringstream ss;
-      fc::to_stream( ss, v, format, max_depth );
-      return ss.str();
-   }
-
-
-    std::string pretty_print( const std::string& v, uint8_t indent ) {
-      int level = 0;
-      fc::stringstream ss;
-      bool first = false;
-      bool quote = false;
-      bool escape = false;
-      for( uint32_t i = 0; i < v.size(); ++i ) {
-         switch( v[i] ) {
-            case '\\':
-              if( !escape ) {
-                if( quote )
-                  escape = true;
-              } else { escape = false; }
-              ss<<v[i];
-              break;
-            case ':':
-              if( !quote ) {
-                ss<<": ";
-              } else {
-                ss<<':';
-              }
-              break;
-            case '"':
-              if( first ) {
-                 ss<<'\n';
-                 for( int i = 0; i < level*indent; ++i ) ss<<' ';
-                 first = false;
-              }
-              if( !escape ) {
-                quote = !quote;
-              }
-              escape = false;
-              ss<<'"';
-              break;
-            case '{':
-            case '[':
-              ss<<v[i];
-              if( !quote ) {
-                ++level;
-                first = true;
-              }else {
-                escape = false;
-              }
-              break;
-            case '}':
-            case ']':
-              if( !quote ) {
-                if( v[i-1] != '[' && v[i-1] != '{' ) {
-                  ss<<'\n';
-                }
-                --level;
-                if( !first ) {
-                  for( int i = 0; i < level*indent; ++i ) ss<<' ';
-                }
-                first = false;
-                ss<<v[i];
-                break;
-              } else {
-                escape = false;
-                ss<<v[i];
-              }
-              break;
-            case ',':
-              if( !quote ) {
-                ss<<',';
-                first = true;
-              } else {
-                escape = false;
-                ss<<',';
-              }
-              break;
-            case 'n':
-              //If we're in quotes and see a \n, just print it literally but unset the escape flag.
-              if( quote && escape )
-                escape = false;
-              FALLTHROUGH
-            default:
-              if( first ) {
-                 ss<<'\n';
-                 for( int i = 0; i < level*indent; ++i ) ss<<' ';
-                 first = false;
-              }
-              ss << v[i];
+      begin_array();
+      for( auto itr = a.begin(); itr != a.end(); ++itr )
+      {
+         element( itr == a.begin() );
+         write( *itr, max_depth );
+      }
+      end_array( a.empty() );
+   }
+
+   void json_writer::write( const variant_object& o, uint32_t max_depth )
+   {
+      begin_object();
+      for( auto itr = o.begin(); itr != o.end(); ++itr )
+      {
+         key( itr->key().data(), itr->key().size(), itr == o.begin() );
+         write( itr->value(), max_depth );
+      }
+      end_object( o.size() == 0 );
+   }
+
+   void json_writer::write( const std::string& str )
+   {
+      value_start();
+      write_quoted( str.data(), str.size() );
+   }
+
+   void json_writer::begin_object()
+   {
+      // nested containers open on the line of the '[' or ',' before them
+      _element_newline = false;
+      _out += '{';
+      ++_level;
+   }
+
+   void json_writer::key( const char* name, size_t size, bool first )
+   {
+      maybe_flush();
+      if( !first )
+         _out += ',';
+      if( _pretty )
+         newline();
+      write_quoted( name, size );
+      if( _pretty )
+         _out.append( ": ", 2 );
+      else
+         _out += ':';
+   }
+
+   void json_writer::end_object( bool empty )
+   {
+      --_level;
+      if( _pretty && !empty )
+         newline();
+      _out += '}';
+   }
+
+   void json_writer::begin_array()
+   {
+      _element_newline = false;
+      _out += '[';
+      ++_level;
+   }
+
+   void json_writer::element( bool first )
+   {
+      maybe_flush();
+      if( !first )
+         _out += ',';
+      _element_newline = _pretty;
+   }
+
+   void json_writer::end_array( bool empty )
+   {
+      --_level;
+      if( _pretty && !empty )
+         newline();
+      _out += ']';
+   }
+
+   void json_writer::value_start()
+   {
+      if( _element_newline )
+      {
+         _element_newline = false;
+         newline();
+      }
+   }
+
+   /**
+    *  Backslash, quote and the control characters are escaped, \b \f \n \r \t
+    *  by name and the others as \u00XX, every other byte (including UTF-8
+    *  sequences) is copied as is.
+    */
+   void json_writer::write_quoted( const char* str, size_t size )
+   {
+      _out += '"';
+      const char* end = str + size;
+      while( true )
+      {
+         const char* special = detail::find_escape( str, end );
+         _out.append( str, special );
+         if( special == end )
+            break;
+         write_escape( *special );
+         str = special + 1;
+      }
+      _out += '"';
+   }
+
+   void json_writer::write_escape( char c )
+   {
+      switch( c )
+      {
+         case '\b': _out.append( "\\b", 2 );  return;
+         case '\f': _out.append( "\\f", 2 );  return;
+         case '\n': _out.append( "\\n", 2 );  return;
+         case '\r': _out.append( "\\r", 2 );  return;
+         case '\t': _out.append( "\\t", 2 );  return;
+         case '\\': _out.append( "\\\\", 2 ); return;
+         case '"':  _out.append( "\\\"", 2 ); return;
+         default:
+         {
+            static const char hex[] = "0123456789abcdef";
+            const char code[] = { '\\', 'u', '0', '0', hex[(c >> 4) & 0xf], hex[c & 0xf] };
+            _out.append( code, sizeof(code) );
          }
       }
-      return ss.str();
-    }
+   }
 
+   void json_writer::write_uint( uint64_t u )
+   {
+      char buf[20];
+      char* p = buf + sizeof(buf);
+      do {
+         *--p = char( '0' + u % 10 );
+         u /= 10;
+      } while( u );
+      _out.append( p, buf + sizeof(buf) );
+   }
 
+   void json_writer::write_int( int64_t i )
+   {
+      if( i < 0 )
+      {
+         _out += '-';
+         write_uint( 0 - uint64_t(i) );
+      }
+      else
+         write_uint( uint64_t(i) );
+   }
+
+   /** Same digits as fc::to_string(double) */
+   void json_writer::write_double( double d )
+   {
+      char buf[512]; // DBL_MAX has 309 integer digits
+      const int len = snprintf( buf, sizeof(buf), "%.*f", std::numeric_limits<double>::digits10 + 2, d );
+      _out.append( buf, std::min<size_t>( len, sizeof(buf) - 1 ) );
+   }
+
+   void json_writer::newline()
+   {
+      _out += '\n';
+      _out.append( size_t(_level) * 2, ' ' );
+   }
+
+   ostream& json::to_stream( ostream& out, const std::string& str )
+   {
+        std::string text;
+        json_writer( text, stringify_large_ints_and_doubles ).write( str );
+        out.write( text.data(), text.size() );
+        return out;
+   }
+
+   void json::append_to_string( std::string& out, const variant& v, output_formatting format, uint32_t max_depth,
+                                bool pretty )
+   {
+      json_writer( out, format, pretty ).write( v, max_depth );
+   }
+
+   std::string   json::to_string( const variant& v, output_formatting format, uint32_t max_depth )
+   {
+      std::string out;
+      append_to_string( out, v, format, max_depth );
+      return out;
+   }
 
    std::string json::to_pretty_string( const variant& v, output_formatting format, uint32_t max_depth )
    {
-	   return pretty_print(to_string(v, format, max_depth), 2);
+      std::string out;
+      append_to_string( out, v, format, max_depth, true );
+      return out;
    }
 
-   void json::save_to_file( const variant& v, const fc::path& fi, bool pretty, output_formatting format, uint32_t max_depth )
+   namespace detail
    {
-      if( pretty )
+      static void sync_file( std::FILE* f, const fc::path& p )
       {
-        auto str = json::to_pretty_string( v, format, max_depth );
-        fc::ofstream o(fi);
-        o.write( str.c_str(), str.size() );
+#ifdef _WIN32
+         const int result = _commit( _fileno( f ) );
+#else
+         const int result = ::fsync( fileno( f ) );
+#endif
+         FC_ASSERT( result == 0, "Unable to sync ${file}: ${error}", ("file",p)("error",strerror(errno)) );
       }
-      else
+
+      /** Makes a new directory entry durable, there is no such thing on Windows */
+      static void sync_directory( const fc::path& dir )
+      {
+#ifndef _WIN32
+         const int fd = ::open( dir.generic_string().c_str(), O_RDONLY );
+         FC_ASSERT( fd >= 0, "Unable to open ${dir}: ${error}", ("dir",dir)("error",strerror(errno)) );
+         const int result = ::fsync( fd );
+         const int error = errno;
+         ::close( fd );
+         FC_ASSERT( result == 0, "Unable to sync ${dir}: ${error}", ("dir",dir)("error",strerror(error)) );
+#endif
+      }
+   }
+
+   namespace detail
+   {
+      /** Gives the temporary file @p f the mode and, where allowed, the owner of @p target,
+       *  so that renaming it over @p target keeps them */
+      static void copy_target_attributes( std::FILE* f, const fc::path& file, const fc::path& target )
+      {
+#ifdef _WIN32
+         boost::system::error_code ec;
+         const boost::filesystem::file_status status = boost::filesystem::status( target, ec );
+         if( ec || !boost::filesystem::exists( status ) )
+            return; // a new file keeps the default permissions
+         boost::filesystem::permissions( file, status.permissions(), ec );
+         FC_ASSERT( !ec, "Unable to set the permissions of ${file}: ${error}", ("file",file)("error",ec.message()) );
+#else
+         struct stat st;
+         if( ::stat( target.generic_string().c_str(), &st ) != 0 )
+            return; // a new file keeps the default mode
+         const int fd = fileno( f );
+         // only root can give a file away, anybody else already owns it; chown before chmod,
+         // which would otherwise clear the set-user-ID and set-group-ID bits again
+         if( ::fchown( fd, st.st_uid, st.st_gid ) != 0 )
+            dlog( "Unable to give ${file} the owner of ${target}", ("file",file)("target",target) );
+         FC_ASSERT( ::fchmod( fd, st.st_mode & 07777 ) == 0, "Unable to set the mode of ${file}: ${error}",
+                    ("file",file)("error",strerror(errno)) );
+#endif
+      }
+   }
+
+   json_file_writer::json_file_writer( const fc::path& file, const json::save_options& opts )
+   :_opts(opts),_target(file),_file(file),
+    _writer( _buffer, opts.format, opts.pretty, std::max<size_t>( opts.buffer_size, 1 ), [this]() { write_buffer(); } )
+   {
+      if( _opts.atomic_replace )
+         _file = _target.parent_path() / ( _target.filename().string() + "." + fc::unique_path().string() + ".tmp" );
+#ifdef _WIN32
+      _out = ::_wfopen( _file.wstring().c_str(), L"wb" );
+#else
+      _out = std::fopen( _file.generic_string().c_str(), "wb" );
+#endif
+      FC_ASSERT( _out != nullptr, "Unable to open ${file}: ${error}", ("file",_file)("error",strerror(errno)) );
+      if( _opts.atomic_replace )
+      {
+         try
+         {
+            detail::copy_target_attributes( _out, _file, _target );
+         }
+         catch( ... )
+         {
+            std::fclose( _out );
+            _out = nullptr;
+            boost::system::error_code ec;
+            boost::filesystem::remove( _file, ec );
+            throw;
+         }
+      }
+      // the buffer below is all the buffering needed
+      std::setvbuf( _out, nullptr, _IONBF, 0 );
+      _buffer.reserve( _opts.buffer_size + 1024 );
+   }
+
+   json_file_writer::~json_file_writer()
+   {
+      if( _out != nullptr )
+         std::fclose( _out );
+      if( _opts.atomic_replace && !_committed )
       {
-       fc::ofstream o(fi);
-       fc::to_stream( o, v, format, max_depth );
+         boost::system::error_code ec;
+         boost::filesystem::remove( _file, ec );
       }
    }
+
+   void json_file_writer::write_buffer()
+   {
+      if( _buffer.empty() )
+         return;
+      const size_t written = std::fwrite( _buffer.data(), 1, _buffer.size(), _out );
+      FC_ASSERT( written == _buffer.size(), "Unable to write ${file}: ${error}", ("file",_file)("error",strerror(errno)) );
+      _buffer.clear();
+   }
+
+   void json_file_writer::commit()
+   {
+      write_buffer();
+      if( _opts.sync != json::no_sync )
+         detail::sync_file( _out, _file );
+      std::FILE* out = _out;
+      _out = nullptr;
+      FC_ASSERT( std::fclose( out ) == 0, "Unable to close ${file}: ${error}", ("file",_file)("error",strerror(errno)) );
+      if( _opts.atomic_replace )
+         fc::rename( _file, _target );
+      _committed = true;
+      if( _opts.sync == json::sync_file_and_directory )
+         detail::sync_directory( _target.parent_path().string().empty() ? fc::path( "." ) : _target.parent_path() );
+   }
+
+   void json::save_to_file( const variant& v, const fc::path& fi, bool pretty, output_formatting format, uint32_t max_depth )
+   {
+      save_options opts;
+      opts.pretty = pretty;
+      opts.format = format;
+      opts.max_depth = max_depth;
+      save_to_file( v, fi, opts );
+   }
+
+   void json::save_to_file( const variant& v, const fc::path& fi, const save_options& opts )
+   {
+      json_file_writer file( fi, opts );
+      file.writer().write( v, opts.max_depth );
+      file.commit();
+   }
    variant json::from_file( const fc::path& p, parse_type ptype, uint32_t max_depth )
    {
-      fc::istream_ptr in( new fc::ifstream( p ) );
-      fc::buffered_istream bin( in );
-      return from_stream( bin, ptype, max_depth );
+      fc::mapped_file file( p );
+      if( !file.data() )
+      {
+         // FIFOs, devices like /dev/stdin and empty files aren't mapped, stream them instead
+         fc::istream_ptr in( new fc::ifstream( p ) );
+         fc::buffered_istream bin( in );
+         return parse_json_variant( bin, ptype, max_depth );
+      }
+      detail::json_buffer_stream in( file.data(), file.data() + file.size() );
+      return parse_json_variant( in, ptype, max_depth );
    }
    variant json::from_stream( buffered_istream& in, parse_type ptype, uint32_t max_depth )
    {
-      switch( ptype )
+      return parse_json_variant( in, ptype, max_depth );
+   }
+
+   namespace detail
+   {
+      /** Writes the JSON text of @p v to @p out a chunk at a time, like json_file_writer does */
+      template<typename T>
+      static ostream& stream_json( ostream& out, const T& v, json::output_formatting format, uint32_t max_depth )
       {
-          case legacy_parser:
-              return variant_from_stream<fc::buffered_istream, legacy_parser>( in, max_depth );
-#ifdef WITH_EXOTIC_JSON_PARSERS
-          case legacy_parser_with_string_doubles:
-              return variant_from_stream<fc::buffered_istream, legacy_parser_with_string_doubles>( in, max_depth );
-          case strict_parser:
-              return json_relaxed::variant_from_stream<buffered_istream, true>( in, max_depth );
-          case relaxed_parser:
-              return json_relaxed::variant_from_stream<buffered_istream, false>( in, max_depth );
-#endif
-          case broken_nul_parser:
-              return variant_from_stream<fc::buffered_istream, broken_nul_parser>( in, max_depth );
-          default:
-              FC_ASSERT( false, "Unknown JSON parser type {ptype}", ("ptype", ptype) );
+         const size_t chunk_size = json::save_options().buffer_size;
+         std::string text;
+         text.reserve( chunk_size + 1024 );
+         auto flush = [&out,&text]() {
+            out.write( text.data(), text.size() );
+            text.clear();
+         };
+         json_writer( text, format, false, chunk_size, flush ).write( v, max_depth );
+         flush();
+         return out;
       }
    }
 
    ostream& json::to_stream( ostream& out, const variant& v, output_formatting format, uint32_t max_depth )
    {
-      fc::to_stream( out, v, format, max_depth );
-      return out;
+      return detail::stream_json( out, v, format, max_depth );
    }
    ostream& json::to_stream( ostream& out, const variants& v, output_formatting format, uint32_t max_depth )
    {
-      fc::to_stream( out, v, format, max_depth );
-      return out;
+      return detail::stream_json( out, v, format, max_depth );
    }
    ostream& json::to_stream( ostream& out, const variant_object& v, output_formatting format, uint32_t max_depth )
    {
-      fc::to_stream( out, v, format, max_depth );
-      return out;
+      return detail::stream_json( out, v, format, max_depth );
    }
 
    bool json::is_valid( const std::string& utf8_str, parse_type ptype, uint32_t max_depth )
    {
       if( utf8_str.size() == 0 ) return false;
-      fc::istream_ptr in( new fc::stringstream( utf8_str ) );
-      fc::buffered_istream bin( in );
-      from_stream( bin, ptype, max_depth );
-      try { bin.peek(); } catch ( const eof_exception& e ) { return true; }
-      return false;
+      detail::json_buffer_stream in( utf8_str.data(), utf8_str.data() + utf8_str.size() );
+      parse_json_variant( in, ptype, max_depth );
+      return in.at_end();
    }
 
 } // fc
@@ -6,13 +6,115 @@
 #include <fc/thread/thread.hpp>
 #include <fc/variant.hpp>
 #include <boost/thread/mutex.hpp>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
 #include <iomanip>
+#include <mutex>
 #include <queue>
 #include <sstream>
 #include <iostream>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
 
 namespace fc {
 
+   namespace detail
+   {
+      /**
+       *  A bounded queue of log lines for many producers and one consumer, after the
+       *  bounded MPMC queue of Dmitry Vyukov.  Every cell has a sequence number that
+       *  tells whether it is free for the producer at a position or filled for the
+       *  consumer, so neither side takes a lock.
+       */
+      class log_line_queue
+      {
+         public:
+            explicit log_line_queue( uint32_t size )
+            {
+               size_t capacity = 2;
+               while( capacity < size )
+                  capacity *= 2;
+               _cells.reset( new cell[capacity] );
+               _mask = capacity - 1;
+               for( size_t i = 0; i < capacity; ++i )
+                  _cells[i].seq.store( i, std::memory_order_relaxed );
+            }
+
+            size_t capacity()const { return _mask + 1; }
+
+            /** Moves @p line into the queue, false if it is full */
+            bool try_push( std::string& line )
+            {
+               size_t pos = _push_pos.load( std::memory_order_relaxed );
+               for(;;)
+               {
+                  cell& c = _cells[pos & _mask];
+                  const size_t seq = c.seq.load( std::memory_order_acquire );
+                  const intptr_t diff = intptr_t( seq ) - intptr_t( pos );
+                  if( diff == 0 )
+                  {
+                     if( _push_pos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) )
+                     {
+                        std::swap( c.line, line );
+                        c.seq.store( pos + 1, std::memory_order_release );
+                        return true;
+                     }
+                  }
+                  else if( diff < 0 )
+                     return false;
+                  else
+                     pos = _push_pos.load( std::memory_order_relaxed );
+               }
+            }
+
+            /** Consumer only, swaps the oldest line into @p line, false if the queue is empty */
+            bool try_pop( std::string& line )
+            {
+               cell& c = _cells[_pop_pos & _mask];
+               if( c.seq.load( std::memory_order_acquire ) != _pop_pos + 1 )
+                  return false;
+               std::swap( c.line, line ); // the cell keeps the buffer of line for the next producer
+               c.seq.store( _pop_pos + _mask + 1, std::memory_order_release );
+               ++_pop_pos;
+               return true;
+            }
+
+            /** Approximate, lines being pushed right now may or may not be counted */
+            size_t size()const
+            {
+               const size_t pushed = _push_pos.load();
+               const size_t popped = _pop_count.load( std::memory_order_relaxed );
+               return pushed > popped ? pushed - popped : 0;
+            }
+
+            /** Consumer only, publishes the pops for size() */
+            void update_size() { _pop_count.store( _pop_pos, std::memory_order_relaxed ); }
+
+         private:
+            struct cell
+            {
+               std::atomic<size_t> seq;
+               std::string         line;
+            };
+
+            // the padding keeps the producer and consumer positions on separate cache
+            // lines, alignas() would be ignored by new before C++17
+            std::unique_ptr<cell[]> _cells;
+            size_t                  _mask;
+            char                    _pad0[64];
+            std::atomic<size_t>     _push_pos{ 0 };
+            char                    _pad1[64];
+            size_t                  _pop_pos = 0;
+            std::atomic<size_t>     _pop_count{ 0 };
+      };
+   } // namespace detail
+
    class file_appender::impl
    {
       public:
@@ -20,7 +122,23 @@ namespace fc {
          ofstream                   out;
          boost::mutex               slock;
 
+         // async mode
+         std::unique_ptr<detail::log_line_queue> queue;
+         std::atomic<uint64_t>      dropped{ 0 };
+         std::atomic<uint64_t>      overflowed{ 0 }; ///< lines that found the queue full, for sampling
+
       private:
+#ifndef _WIN32
+         int                        _fd = -1; ///< async mode writes here with writev() instead of to out
+#endif
+         std::thread                _writer;
+         std::mutex                 _wake_mutex;
+         std::condition_variable    _wake;       ///< the writer waits here for lines
+         std::condition_variable    _space;      ///< blocked producers wait here for space in the queue
+         std::atomic<bool>          _writer_idle{ false };
+         std::atomic<uint32_t>      _blocked_producers{ 0 };
+         bool                       _stopping = false; ///< guarded by _wake_mutex
+
          future<void>               _deletion_task;
          boost::atomic<int64_t>     _current_file_number;
          const int64_t              _interval_seconds;
@@ -41,17 +159,34 @@ namespace fc {
                   rotate_files( true );
                   delete_files();
                } else {
-                  out.open( cfg.filename, std::ios_base::out | std::ios_base::app);
+                  open_file( cfg.filename );
                }
             }
             catch( ... )
             {
                std::cerr << "error opening log file: " << cfg.filename.preferred_string() << "\n";
             }
+
+            if( cfg.async )
+            {
+               FC_ASSERT( cfg.async_queue_size > 0 && cfg.async_sample_rate > 0 );
+               queue.reset( new detail::log_line_queue( cfg.async_queue_size ) );
+               _writer = std::thread( [this](){ run_writer(); } );
+            }
          }
 
          ~impl()
          {
+            if( _writer.joinable() )
+            {
+               {
+                  std::lock_guard<std::mutex> lock( _wake_mutex );
+                  _stopping = true;
+               }
+               _wake.notify_one();
+               _writer.join();
+            }
+            close_file();
             try
             {
               _deletion_task.cancel_and_wait("file_appender is destructing");
@@ -61,6 +196,186 @@ namespace fc {
             }
          }
 
+         void open_file( const fc::path& p )
+         {
+#ifndef _WIN32
+            if( cfg.async )
+            {
+               _fd = ::open( p.string().c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644 );
+               return;
+            }
+#endif
+            out.open( p, std::ios_base::out | std::ios_base::app );
+         }
+
+         void close_file()
+         {
+#ifndef _WIN32
+            if( _fd >= 0 )
+            {
+               ::close( _fd );
+               _fd = -1;
+               return;
+            }
+#endif
+            out.flush();
+            out.close();
+         }
+
+         /** Writes one line, or queues it in async mode */
+         void write( std::string&& line )
+         {
+            if( !queue )
+            {
+               fc::scoped_lock<boost::mutex> lock( slock );
+               out.writesome( line.data(), line.size() );
+               if( cfg.flush )
+                 out.flush();
+               return;
+            }
+
+            if( !queue->try_push( line ) )
+            {
+               if( cfg.async_overflow == overflow::drop
+                   || ( cfg.async_overflow == overflow::sample && ++overflowed % cfg.async_sample_rate != 0 ) )
+               {
+                  ++dropped;
+                  return;
+               }
+               ++_blocked_producers;
+               while( !queue->try_push( line ) )
+               {
+                  wake_writer();
+                  std::unique_lock<std::mutex> lock( _wake_mutex );
+                  _space.wait_for( lock, std::chrono::milliseconds( 1 ) );
+               }
+               --_blocked_producers;
+            }
+            // pairs with the writer setting _writer_idle before it looks at the queue
+            std::atomic_thread_fence( std::memory_order_seq_cst );
+            // without flush the writer only needs waking once the queue gets full
+            if( _writer_idle.load() && ( cfg.flush || queue->size() >= queue->capacity() / 2 ) )
+               wake_writer();
+         }
+
+         void wake_writer()
+         {
+            std::lock_guard<std::mutex> lock( _wake_mutex );
+            _wake.notify_one();
+         }
+
+         void run_writer()
+         {
+            const size_t max_batch = 256; // below IOV_MAX everywhere
+            std::vector<std::string> batch( max_batch );
+            uint64_t reported_dropped = 0;
+            for(;;)
+            {
+               size_t count = 0;
+               while( count < max_batch && queue->try_pop( batch[count] ) )
+                  ++count;
+               queue->update_size();
+               if( _blocked_producers.load() )
+                  _space.notify_all();
+
+               if( count > 0 || dropped.load() != reported_dropped )
+               {
+                  // nobody could catch an exception of this thread, so report it like a failure to open the file
+                  try
+                  {
+                     const uint64_t now_dropped = dropped.load();
+                     if( now_dropped != reported_dropped && count < max_batch )
+                     {
+                        const uint64_t newly_dropped = now_dropped - reported_dropped;
+                        reported_dropped = now_dropped;
+                        batch[count++] = "file_appender: " + fc::to_string( newly_dropped )
+                                         + " log messages dropped, the queue was full\n";
+                     }
+                     rotate_files();
+                     write_batch( batch.data(), count );
+                  }
+                  catch( const fc::exception& e )
+                  {
+                     std::cerr << "error writing log file: " << cfg.filename.preferred_string() << ": "
+                               << e.to_detail_string() << "\n";
+                  }
+                  catch( const std::exception& e )
+                  {
+                     std::cerr << "error writing log file: " << cfg.filename.preferred_string() << ": " << e.what() << "\n";
+                  }
+                  catch( ... )
+                  {
+                     std::cerr << "error writing log file: " << cfg.filename.preferred_string() << "\n";
+                  }
+                  for( size_t i = 0; i < count; ++i )
+                     batch[i].clear();
+                  if( count == max_batch )
+                     continue;
+                  // while lines keep coming producers need not wake the writer for each of them,
+                  // it only waits for a wakeup after a pass found nothing
+                  std::this_thread::sleep_for( std::chrono::microseconds( 50 ) );
+                  continue;
+               }
+
+               std::unique_lock<std::mutex> lock( _wake_mutex );
+               if( _stopping )
+               {
+                  if( queue->size() == 0 )
+                     break;
+                  continue;
+               }
+               _writer_idle.store( true );
+               if( queue->size() == 0 )
+                  _wake.wait_for( lock, std::chrono::microseconds( cfg.async_flush_interval.count() ) );
+               _writer_idle.store( false );
+            }
+         }
+
+         void write_batch( std::string* lines, size_t count )
+         {
+#ifndef _WIN32
+            if( _fd >= 0 )
+            {
+               struct iovec iov[256];
+               size_t n = 0;
+               for( size_t i = 0; i < count; ++i )
+               {
+                  iov[n].iov_base = const_cast<char*>( lines[i].data() );
+                  iov[n].iov_len = lines[i].size();
+                  ++n;
+               }
+               struct iovec* next = iov;
+               while( n > 0 )
+               {
+                  ssize_t written = ::writev( _fd, next, int(n) );
+                  if( written < 0 )
+                  {
+                     if( errno == EINTR )
+                        continue;
+                     return; // nothing sensible to do about a failing log file
+                  }
+                  // skip what was written, a partial write may end inside a line
+                  while( n > 0 && size_t(written) >= next->iov_len )
+                  {
+                     written -= next->iov_len;
+                     ++next;
+                     --n;
+                  }
+                  if( n > 0 )
+                  {
+                     next->iov_base = static_cast<char*>( next->iov_base ) + written;
+                     next->iov_len -= written;
+                  }
+               }
+               return;
+            }
+#endif
+            fc::scoped_lock<boost::mutex> lock( slock );
+            for( size_t i = 0; i < count; ++i )
+               out.writesome( lines[i].data(), lines[i].size() );
+            out.flush();
+         }
+
          void rotate_files( bool initializing = false )
          {
              if( !cfg.rotate ) return;
@@ -87,12 +402,9 @@ namespace fc {
                fc::scoped_lock<boost::mutex> lock( slock );
 
                if( !initializing )
-               {
-                   out.flush();
-                   out.close();
-               }
+                   close_file();
                remove_all(link_filename);  // on windows, you can't delete the link while the underlying file is opened for writing
-               out.open( log_filename, std::ios_base::out | std::ios_base::app );
+               open_file( log_filename );
                create_hard_link(log_filename, link_filename);
              }
          }
@@ -153,10 +465,16 @@ namespace fc {
 
    file_appender::~file_appender(){}
 
+   uint64_t file_appender::dropped_messages()const
+   {
+      return my->dropped.load();
+   }
+
    // MS THREAD METHOD  MESSAGE \t\t\t File:Line
    void file_appender::log( const log_message& m )
    {
-      my->rotate_files();
+      if( !my->queue ) // the writer thread rotates in async mode
+         my->rotate_files();
 
       std::stringstream line;
       line << string(m.get_context().get_timestamp()) << " ";
@@ -181,12 +499,8 @@ namespace fc {
       std::string message = fc::format_string( m.get_format(), m.get_data(), my->cfg.max_object_depth );
       line << message.c_str();
 
-      {
-        fc::scoped_lock<boost::mutex> lock( my->slock );
-        my->out << line.str() << "\t\t\t" << m.get_context().get_file() << ":" << m.get_context().get_line_number() << "\n";
-        if( my->cfg.flush )
-          my->out.flush();
-      }
+      line << "\t\t\t" << m.get_context().get_file() << ":" << m.get_context().get_line_number() << "\n";
+      my->write( line.str() );
    }
 
 } // fc
@@ -20,6 +20,10 @@
 #include <fc/thread/thread.hpp>
 #include <fc/asio.hpp>
 
+#include <atomic>
+#include <deque>
+#include <mutex>
+
 #if WIN32
 #include <wincrypt.h>
 #endif
@@ -59,6 +63,15 @@ namespace fc { namespace http {
          SSL_CTX_set_cert_store( ctx.native_handle(), store );
       }
 #endif
+      struct inbound_queue;
+      typedef std::shared_ptr<inbound_queue> inbound_queue_ptr;
+
+      /** Base of the websocketpp connections, a server keeps the inbound queue of an open connection here */
+      struct connection_data
+      {
+         inbound_queue_ptr inbound;
+      };
+
       struct asio_with_stub_log : public websocketpp::config::asio {
 
           typedef asio_with_stub_log type;
@@ -77,6 +90,7 @@ namespace fc { namespace http {
           typedef websocketpp::log::stub alog_type;
 
           typedef base::rng_type rng_type;
+          typedef connection_data connection_base;
 
           struct transport_config : public base::transport_config {
               typedef type::concurrency_type concurrency_type;
@@ -117,6 +131,7 @@ namespace fc { namespace http {
           typedef websocketpp::log::stub alog_type;
 
           typedef base::rng_type rng_type;
+          typedef connection_data connection_base;
 
           struct transport_config : public base::transport_config {
               typedef type::concurrency_type concurrency_type;
@@ -156,6 +171,7 @@ namespace fc { namespace http {
          typedef websocketpp::log::stub alog_type;
 
          typedef base::rng_type rng_type;
+         typedef connection_data connection_base;
 
          struct transport_config : public base::transport_config {
             typedef type::concurrency_type concurrency_type;
@@ -236,50 +252,218 @@ namespace fc { namespace http {
 
       typedef websocketpp::lib::shared_ptr<boost::asio::ssl::context> context_ptr;
 
+      /** Limits and counters of a server, shared by its shards and the asio threads */
+      struct inbound_limits
+      {
+         std::atomic<uint32_t> max_queued_messages{ 100 };
+         std::atomic<uint32_t> max_workers{ 100 };
+         std::atomic<uint64_t> read_pauses{ 0 };
+      };
+
+      /**
+       *  Messages a connection received but the server did not pass to on_message() yet.
+       *
+       *  The asio threads count received messages and pause reading in the strand of the
+       *  connection, the messages themselves are only used by the thread of its shard.
+       */
+      struct inbound_queue
+      {
+         uint32_t                 shard = 0;
+         std::atomic<uint32_t>    received{ 0 };       ///< messages not taken by a worker yet
+         std::atomic<bool>        reading_paused{ false };
+         bool                     reading = true;      ///< only used in the strand of the connection
+         std::function<void()>    resume_reading;      ///< interrupts the connection to check if it may read
+
+         websocket_connection_ptr con;
+         std::deque<std::string>  messages;
+         bool                     scheduled = false;   ///< waiting for its turn in the dispatcher
+         bool                     closed    = false;
+      };
+
+      /**
+       *  Passes queued messages to their connections from a bounded number of tasks on
+       *  the thread of a shard.  Connections with queued messages take turns, one message
+       *  per turn, so a client sending many or slow calls does not hold back the others.
+       *
+       *  The tasks keep a reference to the dispatcher, it outlives the server if a
+       *  handler is still running when the server is destroyed.
+       */
+      class inbound_dispatcher : public std::enable_shared_from_this<inbound_dispatcher>
+      {
+         public:
+            inbound_dispatcher( std::shared_ptr<const inbound_limits> limits ) : _limits( std::move( limits ) ) {}
+
+            void push( const inbound_queue_ptr& q, std::string message )
+            {
+               if( q->closed )
+               {
+                  ++_dropped;
+                  return;
+               }
+               q->messages.push_back( std::move( message ) );
+               ++_queued;
+               if( !q->scheduled )
+               {
+                  q->scheduled = true;
+                  _turns.push_back( q );
+               }
+               // workers inside on_message() do not pick up new messages until they return
+               if( _workers - _busy < _queued && _workers < _limits->max_workers )
+               {
+                  ++_workers;
+                  auto self = shared_from_this();
+                  fc::async( [self](){ self->run_worker(); }, "websocket inbound dispatch" );
+               }
+            }
+
+            /** Drops the messages still queued for a closed connection */
+            void close( const inbound_queue_ptr& q )
+            {
+               _dropped += q->messages.size();
+               _queued -= q->messages.size();
+               q->messages.clear();
+               q->closed = true;
+            }
+
+            /** Adds the counters of this dispatcher to @p stats */
+            void add_stats( websocket_server_stats& stats )const
+            {
+               stats.workers             += _workers;
+               stats.busy_workers        += _busy;
+               stats.queued_messages     += _queued;
+               stats.dispatched_messages += _dispatched;
+               stats.dropped_messages    += _dropped;
+            }
+
+         private:
+            void run_worker()
+            {
+               while( !_turns.empty() )
+               {
+                  inbound_queue_ptr q = std::move( _turns.front() );
+                  _turns.pop_front();
+                  if( q->messages.empty() ) // closed meanwhile
+                  {
+                     q->scheduled = false;
+                     continue;
+                  }
+                  std::string message = std::move( q->messages.front() );
+                  q->messages.pop_front();
+                  --_queued;
+                  if( q->messages.empty() )
+                     q->scheduled = false;
+                  else
+                     _turns.push_back( q );
+                  if( --q->received <= _limits->max_queued_messages / 2 && q->reading_paused )
+                     q->resume_reading();
+
+                  ++_dispatched;
+                  ++_busy;
+                  try
+                  {
+                     q->con->on_message( message );
+                  }
+                  catch( const fc::exception& e )
+                  {
+                     wlog( "websocket message handler failed: ${e}", ("e",e.to_detail_string()) );
+                  }
+                  catch( const std::exception& e )
+                  {
+                     wlog( "websocket message handler failed: ${e}", ("e",e.what()) );
+                  }
+                  --_busy;
+               }
+               --_workers;
+            }
+
+            std::shared_ptr<const inbound_limits> _limits;
+            std::deque<inbound_queue_ptr> _turns; ///< connections with queued messages, round-robin
+            uint32_t                      _workers     = 0;
+            uint32_t                      _busy        = 0;
+            uint32_t                      _queued      = 0;
+            uint64_t                      _dispatched  = 0;
+            uint64_t                      _dropped     = 0;
+      };
+
       using websocketpp::connection_hdl;
 
+      /** The connections of a server that are handled by one fc::thread */
+      struct server_shard
+      {
+         typedef std::map<connection_hdl, inbound_queue_ptr, std::owner_less<connection_hdl> > con_map;
+
+         server_shard( fc::thread& t, std::shared_ptr<const inbound_limits> limits )
+            : thread( t ), dispatcher( std::make_shared<inbound_dispatcher>( std::move( limits ) ) ) {}
+
+         fc::thread&                         thread;
+         std::unique_ptr<fc::thread>         own_thread;          ///< thread, unless it is the server thread
+         con_map                             connections;         ///< only used in thread
+         std::shared_ptr<inbound_dispatcher> dispatcher;          ///< only used in thread
+         std::atomic<uint32_t>               connection_count{0}; ///< for picking the shard of a new connection
+      };
+
+      /**
+       *  A websocket server on the asio threads of fc.
+       *
+       *  Every accepted connection is assigned to the shard with the fewest connections,
+       *  its handlers and on_message() run on the thread of that shard.  The first shard
+       *  uses the thread that created the server, the others get a thread of their own.
+       *  The asio callbacks only post tasks to the shards, they do not wait for them.
+       */
       template<typename T>
       class generic_websocket_server_impl
       {
          public:
-            generic_websocket_server_impl( const std::string& forward_header_key )
-               :_server_thread( fc::thread::current() ), _forward_header_key( forward_header_key )
+            typedef typename websocketpp::server<T>::connection_ptr connection_ptr;
+
+            generic_websocket_server_impl( const std::string& forward_header_key, uint32_t shard_count )
+               : _forward_header_key( forward_header_key )
             {
+               FC_ASSERT( shard_count > 0, "A websocket server needs at least one shard" );
+               _shards.reserve( shard_count );
+               _shards.emplace_back( new server_shard( fc::thread::current(), _limits ) );
+               for( uint32_t i = 1; i < shard_count; ++i )
+               {
+                  std::unique_ptr<fc::thread> t( new fc::thread( "websocket shard #" + fc::to_string( i ) ) );
+                  _shards.emplace_back( new server_shard( *t, _limits ) );
+                  _shards.back()->own_thread = std::move( t );
+               }
+
                _server.clear_access_channels( websocketpp::log::alevel::all );
                _server.init_asio( &fc::asio::default_io_service() );
                _server.set_reuse_addr( true );
                _server.set_open_handler( [this]( connection_hdl hdl ){
-                  _server_thread.async( [this, hdl](){
-                     auto new_con = std::make_shared<possibly_proxied_websocket_connection<
-                              typename websocketpp::server<T>::connection_ptr>>( _server.get_con_from_hdl(hdl),
-                                                                                 _forward_header_key );
-                     _on_connection( _connections[hdl] = new_con );
-                  }).wait();
+                  auto con = _server.get_con_from_hdl(hdl);
+                  auto queue = std::make_shared<inbound_queue>();
+                  queue->shard = pick_shard();
+                  init_read_pausing( con, queue );
+                  con->inbound = queue;
+                  {
+                     std::lock_guard<std::mutex> lock( _close_mutex );
+                     ++_connection_count;
+                  }
+                  server_shard& shard = *_shards[queue->shard];
+                  ++shard.connection_count;
+                  shard.thread.async( [this,hdl,con,queue](){
+                     queue->con = std::make_shared<possibly_proxied_websocket_connection<connection_ptr>>(
+                                       con, _forward_header_key );
+                     _shards[queue->shard]->connections[hdl] = queue;
+                     _on_connection( queue->con );
+                  }, "websocket open" );
                });
                _server.set_message_handler( [this]( connection_hdl hdl,
                               typename websocketpp::server<T>::message_ptr msg ){
-                  _server_thread.async( [this,hdl,msg](){
-                     auto current_con = _connections.find(hdl);
-                     if( current_con == _connections.end() )
-                        return;
-                     auto payload = msg->get_payload();
-                     std::shared_ptr<websocket_connection> con = current_con->second;
+                  auto con = _server.get_con_from_hdl(hdl);
+                  inbound_queue_ptr queue = con->inbound;
+                  if( !queue )
+                     return;
+                  count_received( *con, *queue );
+                  _shards[queue->shard]->thread.async( [this,queue,msg](){
                      wlog( "[IN] ${remote_endpoint} ${msg}",
-                           ("remote_endpoint",con->get_remote_endpoint_string()) ("msg",payload) );
-                     ++_pending_messages;
-                     auto f = fc::async([this,con,payload](){
-                        if( _pending_messages )
-                           --_pending_messages;
-                        con->on_message( payload );
-                     });
-                     if( _pending_messages > 100 )
-                        f.wait(); // Note: this is a bit strange, because it forces the server to process all
-                                  //       100 pending messages (assuming this message is the last one) before
-                                  //       trying to accept a new message.
-                                  //       Ideally the `wait` should be canceled immediately when the number of
-                                  //       pending messages falls below 100. That said, wait on the whole queue,
-                                  //       but not wait on one message.
-                  }).wait();
+                           ("remote_endpoint",queue->con->get_remote_endpoint_string())
+                           ("msg",msg->get_payload()) );
+                     _shards[queue->shard]->dispatcher->push( queue, std::move( msg->get_raw_payload() ) );
+                  }, "websocket message" );
                });
 
                _server.set_socket_init_handler( []( websocketpp::connection_hdl hdl,
@@ -289,67 +473,45 @@ namespace fc { namespace http {
                } );
 
                _server.set_http_handler( [this]( connection_hdl hdl ){
-                  _server_thread.async( [this,hdl](){
-                     auto con = _server.get_con_from_hdl(hdl);
-                     auto current_con = std::make_shared<possibly_proxied_websocket_connection<
-                              typename websocketpp::server<T>::connection_ptr>>( con, _forward_header_key );
+                  auto con = _server.get_con_from_hdl(hdl);
+                  con->defer_http_response(); // Note: this can tie up resources if send_http_response() is not
+                                              //       called quickly enough
+                  _shards[pick_shard()]->thread.async( [this,con](){
+                     auto current_con = std::make_shared<possibly_proxied_websocket_connection<connection_ptr>>(
+                                             con, _forward_header_key );
                      _on_connection( current_con );
 
-                     con->defer_http_response(); // Note: this can tie up resources if send_http_response() is not
-                                                 //       called quickly enough
                      std::string remote_endpoint = current_con->get_remote_endpoint_string();
                      std::string request_body = con->get_request_body();
                      wlog( "[HTTP-IN] ${remote_endpoint} ${msg}",
                            ("remote_endpoint",remote_endpoint) ("msg",request_body) );
 
-                     fc::async([current_con, request_body, con, remote_endpoint] {
-                        fc::http::reply response = current_con->on_http(request_body);
-                        ilog( "[HTTP-OUT] ${remote_endpoint} ${status} ${msg}",
-                              ("remote_endpoint",remote_endpoint)
-                              ("status",response.status)
-                              ("msg",response.body_as_string) );
-                        con->set_body( std::move( response.body_as_string ) );
-                        con->set_status( websocketpp::http::status_code::value(response.status) );
-                        con->send_http_response();
-                        current_con->closed();
-                     }, "call on_http");
-                  }).wait();
+                     fc::http::reply response = current_con->on_http(request_body);
+                     ilog( "[HTTP-OUT] ${remote_endpoint} ${status} ${msg}",
+                           ("remote_endpoint",remote_endpoint)
+                           ("status",response.status)
+                           ("msg",response.body_as_string) );
+                     con->set_body( std::move( response.body_as_string ) );
+                     con->set_status( websocketpp::http::status_code::value(response.status) );
+                     con->send_http_response();
+                     current_con->closed();
+                  }, "call on_http" );
                });
 
                _server.set_close_handler( [this]( connection_hdl hdl ){
-                  _server_thread.async( [this,hdl](){
-                     if( _connections.find(hdl) != _connections.end() )
-                     {
-                        _connections[hdl]->closed();
-                        _connections.erase( hdl );
-                        if( _connections.empty() && _all_connections_closed )
-                           _all_connections_closed->set_value();
-                     }
-                     else
-                     {
-                        wlog( "unknown connection closed" );
-                     }
-                  }).wait();
+                  if( !remove_connection( hdl ) )
+                     wlog( "unknown connection closed" );
                });
 
                _server.set_fail_handler( [this]( connection_hdl hdl ){
-                  _server_thread.async( [this,hdl](){
-                     if( _connections.find(hdl) != _connections.end() )
-                     {
-                        _connections[hdl]->closed();
-                        _connections.erase( hdl );
-                        if( _connections.empty() && _all_connections_closed )
-                           _all_connections_closed->set_value();
-                     }
+                  if( !remove_connection( hdl ) )
+                  {
+                     // if the server is shutting down, assume this hdl is the server socket
+                     if( _server_socket_closed )
+                        _server_socket_closed->set_value();
                      else
-                     {
-                        // if the server is shutting down, assume this hdl is the server socket
-                        if( _server_socket_closed )
-                           _server_socket_closed->set_value();
-                        else
-                           wlog( "unknown connection failed" );
-                     }
-                  }).wait();
+                        wlog( "unknown connection failed" );
+                  }
                });
             }
 
@@ -360,51 +522,173 @@ namespace fc { namespace http {
                   // _server.stop_listening() may trigger the on_fail callback function (the lambda function set by
                   //   _server.set_fail_handler(...) ) for the listening server socket (note: the connection handle
                   //   associated with the server socket is not in our connection map),
-                  // the on_fail callback function may fire (async) a new task which may run really late
-                  //   and it will try to access the member variables of this server object,
                   // so we need to wait for it before destructing this object.
                   _server_socket_closed = promise<void>::create();
                   _server.stop_listening();
                }
 
-               // Note: since _connections can be modified by lambda functions in set_*_handler, which are running
-               //       in other tasks, perhaps we need to wait for them (especially the one in set_open_handler)
-               //       being processed. Otherwise `_all_connections_closed.wait()` may hang.
-               if( !_connections.empty() )
+               // Note: a connection being opened right now may be counted but not found in the maps of
+               //       the shards yet, then `_all_connections_closed.wait()` may hang.
+               std::vector<connection_hdl> hdls = connection_handles();
                {
-                  _all_connections_closed = promise<void>::create();
-
-                  auto cpy_con = _connections;
-                  websocketpp::lib::error_code ec;
-                  for( auto& item : cpy_con )
-                     _server.close( item.first, 0, "server exit", ec );
-
-                  _all_connections_closed->wait();
+                  std::lock_guard<std::mutex> lock( _close_mutex );
+                  if( _connection_count > 0 )
+                     _all_connections_closed = promise<void>::create();
                }
+               websocketpp::lib::error_code ec;
+               for( auto& hdl : hdls )
+                  _server.close( hdl, 0, "server exit", ec );
+               if( _all_connections_closed )
+                  _all_connections_closed->wait();
 
                if( _server_socket_closed )
                   _server_socket_closed->wait();
+
+               // the tasks posted by the handlers so far use this object
+               for( auto& shard : _shards )
+                  shard->thread.async( [](){} ).wait();
             }
 
-            typedef std::map<connection_hdl, websocket_connection_ptr, std::owner_less<connection_hdl> > con_map;
+            /** The handles of the open connections of all shards */
+            std::vector<connection_hdl> connection_handles()
+            {
+               std::vector<connection_hdl> hdls;
+               for( auto& shard : _shards )
+               {
+                  server_shard* s = shard.get();
+                  s->thread.async( [s,&hdls](){
+                     for( const auto& item : s->connections )
+                        hdls.push_back( item.first );
+                  }).wait();
+               }
+               return hdls;
+            }
 
-            // Note: std::map is not thread-safe nor task-safe, we may need
-            //       to use a mutex or similar to avoid concurrent access.
-            con_map                  _connections;   ///< Holds accepted connections
-            fc::thread&              _server_thread; ///< The thread that runs the server
+            void set_inbound_limits( uint32_t max_queued_messages, uint32_t max_workers )
+            {
+               FC_ASSERT( max_queued_messages > 0 && max_workers > 0 );
+               _limits->max_queued_messages = max_queued_messages;
+               _limits->max_workers = max_workers;
+            }
+
+            websocket_server_stats get_stats()
+            {
+               websocket_server_stats stats;
+               stats.shards              = _shards.size();
+               stats.max_queued_messages = _limits->max_queued_messages;
+               stats.max_workers         = _limits->max_workers;
+               stats.read_pauses         = _limits->read_pauses;
+               for( uint32_t i = 0; i < _shards.size(); ++i )
+               {
+                  server_shard* s = _shards[i].get();
+                  s->thread.async( [s,i,&stats](){
+                     s->dispatcher->add_stats( stats );
+                     for( const auto& item : s->connections )
+                        stats.connections.push_back( { item.second->con->get_remote_endpoint_string(), i,
+                                                       uint32_t( item.second->messages.size() ),
+                                                       bool( item.second->reading_paused ) } );
+                  }).wait();
+               }
+               return stats;
+            }
+
+         private:
+            /** The shard with the fewest connections */
+            uint32_t pick_shard()const
+            {
+               uint32_t best = 0;
+               for( uint32_t i = 1; i < _shards.size(); ++i )
+                  if( _shards[i]->connection_count < _shards[best]->connection_count )
+                     best = i;
+               return best;
+            }
+
+            /**
+             *  Reading is paused by the message handler, that is inside the read loop of the connection,
+             *  and resumed by an interrupt, that runs in the strand of the read loop.  The pause_reading()
+             *  and resume_reading() of websocketpp are posted to the connection instead, a resume may
+             *  then start a second read while the one started before the pause is still pending.
+             */
+            void init_read_pausing( const connection_ptr& con, const inbound_queue_ptr& queue )
+            {
+               std::shared_ptr<const inbound_limits> limits = _limits;
+               con->set_interrupt_handler( [limits]( connection_hdl hdl ){
+                  auto c = websocketpp::lib::static_pointer_cast<typename connection_ptr::element_type>( hdl.lock() );
+                  if( !c || !c->inbound || c->get_state() != websocketpp::session::state::open )
+                     return;
+                  inbound_queue& q = *c->inbound;
+                  if( !q.reading && q.received <= limits->max_queued_messages / 2 )
+                  {
+                     q.reading = true;
+                     q.reading_paused = false;
+                     c->handle_resume_reading();
+                  }
+               });
+               websocketpp::lib::weak_ptr<typename connection_ptr::element_type> weak_con = con;
+               queue->resume_reading = [weak_con](){
+                  auto c = weak_con.lock();
+                  if( c )
+                     c->interrupt();
+               };
+            }
+
+            /** Called in the strand of the connection for every message, pauses reading when the queue is full */
+            void count_received( typename connection_ptr::element_type& con, inbound_queue& q )
+            {
+               const uint32_t limit = _limits->max_queued_messages;
+               if( ++q.received < limit || !q.reading )
+                  return;
+               q.reading = false;
+               q.reading_paused = true;
+               // a worker that took the messages before it could see reading_paused does not resume
+               if( q.received <= limit / 2 )
+               {
+                  q.reading = true;
+                  q.reading_paused = false;
+                  return;
+               }
+               ++_limits->read_pauses;
+               con.handle_pause_reading();
+            }
+
+            /** Called from the close and fail handlers, false if @p hdl is no open connection */
+            bool remove_connection( connection_hdl hdl )
+            {
+               auto con = websocketpp::lib::static_pointer_cast<typename connection_ptr::element_type>( hdl.lock() );
+               if( !con || !con->inbound )
+                  return false;
+               inbound_queue_ptr queue = std::move( con->inbound ); // the queue refers to the connection
+               _shards[queue->shard]->thread.async( [this,hdl,queue](){
+                  server_shard& shard = *_shards[queue->shard];
+                  shard.dispatcher->close( queue );
+                  queue->con->closed();
+                  shard.connections.erase( hdl );
+                  --shard.connection_count;
+
+                  std::lock_guard<std::mutex> lock( _close_mutex );
+                  if( --_connection_count == 0 && _all_connections_closed )
+                     _all_connections_closed->set_value();
+               }, "websocket close" );
+               return true;
+            }
+
+         public:
+            std::shared_ptr<inbound_limits> _limits = std::make_shared<inbound_limits>();
+            std::vector<std::unique_ptr<server_shard>> _shards;
             websocketpp::server<T>   _server;        ///< The server
             on_connection_handler    _on_connection; ///< A handler to be called when a new connection is accepted
+            std::mutex               _close_mutex;   ///< For _connection_count and _all_connections_closed
+            uint32_t                 _connection_count = 0; ///< Open connections of all shards
             fc::promise<void>::ptr   _all_connections_closed; ///< Promise to wait for all connections to be closed
             fc::promise<void>::ptr   _server_socket_closed; ///< Promise to wait for the server socket to be closed
-            uint32_t                 _pending_messages = 0; ///< Number of messages not processed, for rate limiting
             std::string              _forward_header_key; ///< A header like "X-Forwarded-For" (XFF) with data IP:port
       };
 
       class websocket_server_impl : public generic_websocket_server_impl<asio_with_stub_log>
       {
          public:
-            websocket_server_impl( const std::string& forward_header_key )
-            : generic_websocket_server_impl( forward_header_key )
+            websocket_server_impl( const std::string& forward_header_key, uint32_t shard_count )
+            : generic_websocket_server_impl( forward_header_key, shard_count )
             {}
 
             virtual ~websocket_server_impl() {}
@@ -414,8 +698,8 @@ namespace fc { namespace http {
       {
          public:
             websocket_tls_server_impl( const string& server_pem, const string& ssl_password,
-                                       const std::string& forward_header_key )
-               : generic_websocket_server_impl( forward_header_key )
+                                       const std::string& forward_header_key, uint32_t shard_count )
+               : generic_websocket_server_impl( forward_header_key, shard_count )
             {
                _server.set_tls_init_handler( [server_pem,ssl_password]( websocketpp::connection_hdl hdl ) {
                      context_ptr ctx = websocketpp::lib::make_shared<boost::asio::ssl::context>(
@@ -633,8 +917,8 @@ namespace fc { namespace http {
 
    } // namespace detail
 
-   websocket_server::websocket_server( const std::string& forward_header_key )
-         :my( new detail::websocket_server_impl( forward_header_key ) ) {}
+   websocket_server::websocket_server( const std::string& forward_header_key, uint32_t shard_count )
+         :my( new detail::websocket_server_impl( forward_header_key, shard_count ) ) {}
    websocket_server::~websocket_server(){}
 
    void websocket_server::on_connection( const on_connection_handler& handler )
@@ -669,15 +953,24 @@ namespace fc { namespace http {
 
    void websocket_server::close()
    {
-      auto cpy_con = my->_connections;
       websocketpp::lib::error_code ec;
-      for( auto& connection : cpy_con )
-         my->_server.close( connection.first, websocketpp::close::status::normal, "Goodbye", ec );
+      for( auto& hdl : my->connection_handles() )
+         my->_server.close( hdl, websocketpp::close::status::normal, "Goodbye", ec );
+   }
+
+   void websocket_server::set_inbound_limits( uint32_t max_queued_messages, uint32_t max_workers )
+   {
+      my->set_inbound_limits( max_queued_messages, max_workers );
+   }
+
+   websocket_server_stats websocket_server::get_stats()const
+   {
+      return my->get_stats();
    }
 
    websocket_tls_server::websocket_tls_server( const string& server_pem, const string& ssl_password,
-                                               const std::string& forward_header_key )
-         :my( new detail::websocket_tls_server_impl(server_pem, ssl_password, forward_header_key) )
+                                               const std::string& forward_header_key, uint32_t shard_count )
+         :my( new detail::websocket_tls_server_impl(server_pem, ssl_password, forward_header_key, shard_count) )
    {}
 
    websocket_tls_server::~websocket_tls_server(){}
@@ -714,10 +1007,19 @@ namespace fc { namespace http {
 
    void websocket_tls_server::close()
    {
-      auto cpy_con = my->_connections;
       websocketpp::lib::error_code ec;
-      for( auto& connection : cpy_con )
-         my->_server.close( connection.first, websocketpp::close::status::normal, "Goodbye", ec );
+      for( auto& hdl : my->connection_handles() )
+         my->_server.close( hdl, websocketpp::close::status::normal, "Goodbye", ec );
+   }
+
+   void websocket_tls_server::set_inbound_limits( uint32_t max_queued_messages, uint32_t max_workers )
+   {
+      my->set_inbound_limits( max_queued_messages, max_workers );
+   }
+
+   websocket_server_stats websocket_tls_server::get_stats()const
+   {
+      return my->get_stats();
    }
 
 
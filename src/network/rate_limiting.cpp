@@ -218,14 +218,20 @@ namespace fc
                                uint32_t burstiness_in_seconds = 1);
       ~rate_limiting_group_impl();
 
-      virtual size_t readsome(boost::asio::ip::tcp::socket& socket, char* buffer, size_t length) override;
-      virtual size_t readsome(boost::asio::ip::tcp::socket& socket, const std::shared_ptr<char>& buffer, size_t length, size_t offset) override;
+      virtual size_t readsome(boost::asio::ip::tcp::socket& socket, char* buffer, size_t length,
+                              asio::operation_completion& completion) override;
+      virtual size_t readsome(boost::asio::ip::tcp::socket& socket, const std::shared_ptr<char>& buffer, size_t length, size_t offset,
+                              asio::operation_completion& completion) override;
       template <typename BufferType>
-      size_t readsome_impl(boost::asio::ip::tcp::socket& socket, const BufferType& buffer, size_t length, size_t offset);
-      virtual size_t writesome(boost::asio::ip::tcp::socket& socket, const char* buffer, size_t length) override;
-      virtual size_t writesome(boost::asio::ip::tcp::socket& socket, const std::shared_ptr<const char>& buffer, size_t length, size_t offset) override;
+      size_t readsome_impl(boost::asio::ip::tcp::socket& socket, const BufferType& buffer, size_t length, size_t offset,
+                           asio::operation_completion& completion);
+      virtual size_t writesome(boost::asio::ip::tcp::socket& socket, const char* buffer, size_t length,
+                               asio::operation_completion& completion) override;
+      virtual size_t writesome(boost::asio::ip::tcp::socket& socket, const std::shared_ptr<const char>& buffer, size_t length, size_t offset,
+                               asio::operation_completion& completion) override;
       template <typename BufferType>
-      size_t writesome_impl(boost::asio::ip::tcp::socket& socket, const BufferType& buffer, size_t length, size_t offset);
+      size_t writesome_impl(boost::asio::ip::tcp::socket& socket, const BufferType& buffer, size_t length, size_t offset,
+                            asio::operation_completion& completion);
 
       void process_pending_reads();
       void process_pending_writes();
@@ -268,18 +274,21 @@ namespace fc
       }
     }
 
-    size_t rate_limiting_group_impl::readsome(boost::asio::ip::tcp::socket& socket, const std::shared_ptr<char>& buffer, size_t length, size_t offset)
+    size_t rate_limiting_group_impl::readsome(boost::asio::ip::tcp::socket& socket, const std::shared_ptr<char>& buffer, size_t length, size_t offset,
+                                              asio::operation_completion& completion)
     {
-      return readsome_impl(socket, buffer, length, offset);
+      return readsome_impl(socket, buffer, length, offset, completion);
     }
 
-    size_t rate_limiting_group_impl::readsome(boost::asio::ip::tcp::socket& socket, char* buffer, size_t length)
+    size_t rate_limiting_group_impl::readsome(boost::asio::ip::tcp::socket& socket, char* buffer, size_t length,
+                                              asio::operation_completion& completion)
     {
-      return readsome_impl(socket, buffer, length, 0);
+      return readsome_impl(socket, buffer, length, 0, completion);
     }
 
     template <typename BufferType>
-    size_t rate_limiting_group_impl::readsome_impl(boost::asio::ip::tcp::socket& socket, const BufferType& buffer, size_t length, size_t offset)
+    size_t rate_limiting_group_impl::readsome_impl(boost::asio::ip::tcp::socket& socket, const BufferType& buffer, size_t length, size_t offset,
+                                                   asio::operation_completion& completion)
     {
       size_t bytes_read;
       if (_download_bytes_per_second)
@@ -307,25 +316,28 @@ namespace fc
         _unused_read_tokens += read_operation.permitted_length - bytes_read;
       }
       else
-        bytes_read = asio::read_some(socket, buffer, length, offset);
+        bytes_read = asio::read_some(socket, buffer, length, offset, completion);
       
       _actual_download_rate.update(bytes_read);
       
       return bytes_read;
     }
 
-    size_t rate_limiting_group_impl::writesome(boost::asio::ip::tcp::socket& socket, const char* buffer, size_t length)
+    size_t rate_limiting_group_impl::writesome(boost::asio::ip::tcp::socket& socket, const char* buffer, size_t length,
+                                               asio::operation_completion& completion)
     {
-      return writesome_impl(socket, buffer, length, 0);
+      return writesome_impl(socket, buffer, length, 0, completion);
     }
 
-    size_t rate_limiting_group_impl::writesome(boost::asio::ip::tcp::socket& socket, const std::shared_ptr<const char>& buffer, size_t length, size_t offset)
+    size_t rate_limiting_group_impl::writesome(boost::asio::ip::tcp::socket& socket, const std::shared_ptr<const char>& buffer, size_t length, size_t offset,
+                                               asio::operation_completion& completion)
     {
-      return writesome_impl(socket, buffer, length, offset);
+      return writesome_impl(socket, buffer, length, offset, completion);
     }
 
     template <typename BufferType>
-    size_t rate_limiting_group_impl::writesome_impl(boost::asio::ip::tcp::socket& socket, const BufferType& buffer, size_t length, size_t offset)
+    size_t rate_limiting_group_impl::writesome_impl(boost::asio::ip::tcp::socket& socket, const BufferType& buffer, size_t length, size_t offset,
+                                                    asio::operation_completion& completion)
     {
       size_t bytes_written;
       if (_upload_bytes_per_second)
@@ -353,7 +365,7 @@ namespace fc
         _unused_write_tokens += write_operation.permitted_length - bytes_written;
       }
       else
-        bytes_written = asio::write_some(socket, buffer, length, offset);
+        bytes_written = asio::write_some(socket, buffer, length, offset, completion);
       
       _actual_upload_rate.update(bytes_written);
       
@@ -40,49 +40,43 @@ namespace fc {
           }
           catch( ... )
           {}
-        if( _read_in_progress.valid() )
-          try 
-          { 
-            _read_in_progress.wait();
-          }
-          catch ( ... )
-          {
-          }
-        if( _write_in_progress.valid() )
-          try 
-          { 
-            _write_in_progress.wait();
-          } 
-          catch ( ... )
-          {
-          }
+        _read_completion.wait_idle();
+        _write_completion.wait_idle();
       }
-      virtual size_t readsome(boost::asio::ip::tcp::socket& socket, char* buffer, size_t length) override;
-      virtual size_t readsome(boost::asio::ip::tcp::socket& socket, const std::shared_ptr<char>& buffer, size_t length, size_t offset) override;
-      virtual size_t writesome(boost::asio::ip::tcp::socket& socket, const char* buffer, size_t length) override;
-      virtual size_t writesome(boost::asio::ip::tcp::socket& socket, const std::shared_ptr<const char>& buffer, size_t length, size_t offset) override;
-
-      fc::future<size_t> _write_in_progress;
-      fc::future<size_t> _read_in_progress;
+      virtual size_t readsome(boost::asio::ip::tcp::socket& socket, char* buffer, size_t length,
+                              fc::asio::operation_completion& completion) override;
+      virtual size_t readsome(boost::asio::ip::tcp::socket& socket, const std::shared_ptr<char>& buffer, size_t length, size_t offset,
+                              fc::asio::operation_completion& completion) override;
+      virtual size_t writesome(boost::asio::ip::tcp::socket& socket, const char* buffer, size_t length,
+                               fc::asio::operation_completion& completion) override;
+      virtual size_t writesome(boost::asio::ip::tcp::socket& socket, const std::shared_ptr<const char>& buffer, size_t length, size_t offset,
+                               fc::asio::operation_completion& completion) override;
+
+      fc::asio::operation_completion _write_completion;
+      fc::asio::operation_completion _read_completion;
       boost::asio::ip::tcp::socket _sock;
       tcp_socket_io_hooks* _io_hooks;
   };
 
-  size_t tcp_socket::impl::readsome(boost::asio::ip::tcp::socket& socket, char* buffer, size_t length)
+  size_t tcp_socket::impl::readsome(boost::asio::ip::tcp::socket& socket, char* buffer, size_t length,
+                                    fc::asio::operation_completion& completion)
   {
-    return (_read_in_progress = fc::asio::read_some(socket, buffer, length)).wait();
+    return fc::asio::read_some(socket, buffer, length, 0, completion);
   }
-  size_t tcp_socket::impl::readsome(boost::asio::ip::tcp::socket& socket, const std::shared_ptr<char>& buffer, size_t length, size_t offset)
+  size_t tcp_socket::impl::readsome(boost::asio::ip::tcp::socket& socket, const std::shared_ptr<char>& buffer, size_t length, size_t offset,
+                                    fc::asio::operation_completion& completion)
   {
-    return (_read_in_progress = fc::asio::read_some(socket, buffer, length, offset)).wait();
+    return fc::asio::read_some(socket, buffer, length, offset, completion);
   }
-  size_t tcp_socket::impl::writesome(boost::asio::ip::tcp::socket& socket, const char* buffer, size_t length)
+  size_t tcp_socket::impl::writesome(boost::asio::ip::tcp::socket& socket, const char* buffer, size_t length,
+                                     fc::asio::operation_completion& completion)
   {
-    return (_write_in_progress = fc::asio::write_some(socket, buffer, length)).wait();
+    return fc::asio::write_some(socket, buffer, length, 0, completion);
   }
-  size_t tcp_socket::impl::writesome(boost::asio::ip::tcp::socket& socket, const std::shared_ptr<const char>& buffer, size_t length, size_t offset)
+  size_t tcp_socket::impl::writesome(boost::asio::ip::tcp::socket& socket, const std::shared_ptr<const char>& buffer, size_t length, size_t offset,
+                                     fc::asio::operation_completion& completion)
   {
-    return (_write_in_progress = fc::asio::write_some(socket, buffer, length, offset)).wait();
+    return fc::asio::write_some(socket, buffer, length, offset, completion);
   }
 
 
@@ -115,12 +109,12 @@ namespace fc {
 
   size_t tcp_socket::writesome(const char* buf, size_t len) 
   {
-    return my->_io_hooks->writesome(my->_sock, buf, len);
+    return my->_io_hooks->writesome(my->_sock, buf, len, my->_write_completion);
   }
 
   size_t tcp_socket::writesome(const std::shared_ptr<const char>& buf, size_t len, size_t offset) 
   {
-    return my->_io_hooks->writesome(my->_sock, buf, len, offset);
+    return my->_io_hooks->writesome(my->_sock, buf, len, offset, my->_write_completion);
   }
 
   fc::ip::endpoint tcp_socket::remote_endpoint()const
@@ -146,11 +140,11 @@ namespace fc {
 
   size_t tcp_socket::readsome( char* buf, size_t len ) 
   {
-    return my->_io_hooks->readsome(my->_sock, buf, len);
+    return my->_io_hooks->readsome(my->_sock, buf, len, my->_read_completion);
   }
 
   size_t tcp_socket::readsome( const std::shared_ptr<char>& buf, size_t len, size_t offset ) {
-    return my->_io_hooks->readsome(my->_sock, buf, len, offset);
+    return my->_io_hooks->readsome(my->_sock, buf, len, offset, my->_read_completion);
   }
 
   void tcp_socket::connect_to( const fc::ip::endpoint& remote_endpoint ) {
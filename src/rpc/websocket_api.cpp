@@ -1,6 +1,7 @@
 #include <fc/reflect/variant.hpp>
 #include <fc/rpc/websocket_api.hpp>
 #include <fc/io/json.hpp>
+#include <fc/thread/thread.hpp>
 
 namespace fc { namespace rpc {
 
@@ -51,25 +52,15 @@ websocket_api_connection::websocket_api_connection( const std::shared_ptr<fc::ht
    } );
 
    _connection->on_message_handler( [this]( const std::string& msg ){
-       response reply = on_message(msg);
-       if( _connection && ( reply.id || reply.result || reply.error || reply.jsonrpc ) )
-          _connection->send_message( fc::json::to_string( reply, fc::json::stringify_large_ints_and_doubles,
-                                                          _max_conversion_depth ) );
+       int http_status;
+       std::string reply = on_message( msg, http_status );
+       if( _connection && !reply.empty() )
+          _connection->send_message( reply );
    } );
    _connection->on_http_handler( [this]( const std::string& msg ){
-       response reply = on_message(msg);
        fc::http::reply result;
-       if( reply.error )
-       {
-          if( reply.error->code == -32603 )
-             result.status = fc::http::reply::InternalServerError;
-          else if( reply.error->code <= -32600 )
-             result.status = fc::http::reply::BadRequest;
-       }
-       if( reply.id || reply.result || reply.error || reply.jsonrpc )
-          result.body_as_string = fc::json::to_string( reply, fc::json::stringify_large_ints_and_doubles,
-                                                       _max_conversion_depth );
-       else
+       result.body_as_string = on_message( msg, result.status );
+       if( result.body_as_string.empty() )
           result.status = fc::http::reply::NoContent;
 
        return result;
@@ -89,8 +80,7 @@ variant websocket_api_connection::send_call(
       return variant(); // TODO return an error?
 
    auto request = _rpc_state.start_remote_call( "call", { api_id, std::move(method_name), std::move(args) } );
-   _connection->send_message( fc::json::to_string( fc::variant( request, _max_conversion_depth ),
-                                                   fc::json::stringify_large_ints_and_doubles,
+   _connection->send_message( fc::json::to_string( request, fc::json::stringify_large_ints_and_doubles,
                                                    _max_conversion_depth ) );
    return _rpc_state.wait_for_response( *request.id );
 }
@@ -103,8 +93,7 @@ variant websocket_api_connection::send_callback(
       return variant(); // TODO return an error?
 
    auto request = _rpc_state.start_remote_call( "callback", { callback_id, std::move(args) } );
-   _connection->send_message( fc::json::to_string( fc::variant( request, _max_conversion_depth ),
-                                                   fc::json::stringify_large_ints_and_doubles,
+   _connection->send_message( fc::json::to_string( request, fc::json::stringify_large_ints_and_doubles,
                                                    _max_conversion_depth ) );
    return _rpc_state.wait_for_response( *request.id );
 }
@@ -117,13 +106,18 @@ void websocket_api_connection::send_notice(
       return;
 
    fc::rpc::request req{ optional<uint64_t>(), "notice", { callback_id, std::move(args) } };
-   _connection->send_message( fc::json::to_string( fc::variant( req, _max_conversion_depth ),
-                                                   fc::json::stringify_large_ints_and_doubles,
+   _connection->send_message( fc::json::to_string( req, fc::json::stringify_large_ints_and_doubles,
                                                    _max_conversion_depth ) );
 }
 
-response websocket_api_connection::on_message( const std::string& message )
+void websocket_api_connection::set_batch_read_only_filter( std::function<bool(const request&)> is_read_only )
 {
+   _is_read_only = std::move( is_read_only );
+}
+
+std::string websocket_api_connection::on_message( const std::string& message, int& http_status )
+{
+   http_status = fc::http::reply::OK;
    variant var;
    try
    {
@@ -131,12 +125,84 @@ response websocket_api_connection::on_message( const std::string& message )
    }
    catch( const fc::exception& e )
    {
-      return response( variant(), { -32700, "Invalid JSON message", variant( e, _max_conversion_depth ) }, "2.0" );
+      return reply_text( response( variant(), { -32700, "Invalid JSON message", variant( e, _max_conversion_depth ) },
+                                   "2.0" ),
+                         http_status );
    }
 
-   if( var.is_array() )
-      return response( variant(), { -32600, "Batch requests not supported" }, "2.0" );
+   if( !var.is_array() )
+      return reply_text( on_single_message( var ), http_status );
+
+   if( var.get_array().empty() )
+      return reply_text( response( variant(), { -32600, "Empty batch request" }, "2.0" ), http_status );
+
+   std::vector<response> replies = on_batch( var.get_array() );
+   if( replies.empty() )
+      return std::string();
+   // the array does not take a level from the replies
+   return fc::json::to_string( replies, fc::json::stringify_large_ints_and_doubles, _max_conversion_depth + 1 );
+}
+
+std::string websocket_api_connection::reply_text( const response& reply, int& http_status )const
+{
+   if( reply.error )
+   {
+      if( reply.error->code == -32603 )
+         http_status = fc::http::reply::InternalServerError;
+      else if( reply.error->code <= -32600 )
+         http_status = fc::http::reply::BadRequest;
+   }
+   if( !reply.id && !reply.result && !reply.error && !reply.jsonrpc )
+      return std::string();
+   return fc::json::to_string( reply, fc::json::stringify_large_ints_and_doubles, _max_conversion_depth );
+}
 
+std::vector<response> websocket_api_connection::on_batch( const variants& batch )
+{
+   std::vector<response> replies;
+   replies.reserve( batch.size() );
+   auto add_reply = [&replies]( response reply ) {
+      if( reply.id || reply.result || reply.error || reply.jsonrpc )
+         replies.push_back( std::move( reply ) );
+   };
+   auto is_read_only = [this]( const variant& element ) {
+      if( !_is_read_only || !element.is_object() || !element.get_object().contains( "method" ) )
+         return false;
+      try
+      {
+         return _is_read_only( element.as<request>( _max_conversion_depth ) );
+      }
+      catch( const fc::exception& )
+      {
+         return false; // on_single_message() replies with the error
+      }
+   };
+
+   // read-only requests started but not waited for yet
+   std::vector<fc::future<response>> running;
+   auto wait_running = [&running,&add_reply]() {
+      for( auto& call : running )
+         add_reply( call.wait() );
+      running.clear();
+   };
+   for( const variant& element : batch )
+   {
+      if( is_read_only( element ) )
+      {
+         // a copy of the element, the batch may be gone if an earlier call throws
+         running.push_back( fc::async( [this,element]() { return on_single_message( element ); },
+                                       "websocket_api_connection::on_batch" ) );
+         continue;
+      }
+      wait_running();
+      add_reply( on_single_message( element ) );
+   }
+   wait_running();
+   return replies;
+}
+
+response websocket_api_connection::on_single_message( const variant& var )
+{
    if( !var.is_object() )
       return response( variant(), { -32600, "Invalid JSON request" }, "2.0" );
 
@@ -160,7 +226,7 @@ response websocket_api_connection::on_message( const std::string& message )
       if( var_obj.contains( "params" ) && !var_obj["params"].is_array() )
          return response( variant(), { -32600, "Invalid parameters" }, "2.0" );
 
-      return on_request( std::move( var ) );
+      return on_request( var );
    }
 
    if( var_obj.contains( "result" ) || var_obj.contains("error") )
@@ -168,7 +234,7 @@ response websocket_api_connection::on_message( const std::string& message )
       if( !var_obj.contains( "id" ) || ( var_obj["id"].is_null() && !var_obj.contains( "jsonrpc" ) ) )
          return response( variant(), { -32600, "Missing or invalid id" }, "2.0" );
 
-      on_response( std::move( var ) );
+      on_response( var );
 
       return response();
    }
@@ -1,6 +1,9 @@
 #pragma once
 #include <fc/thread/thread.hpp>
 #include <fc/exception/exception.hpp>
+#include "indexed_heap.hpp"
+#include <boost/atomic.hpp>
+#include <algorithm>
 #include <vector>
 
 #include <boost/version.hpp>
@@ -15,30 +18,127 @@
 #endif
 
 #if BOOST_VERSION >= 106100
-  #include <boost/coroutine/stack_allocator.hpp>
+  #include <boost/coroutine/protected_stack_allocator.hpp>
   namespace bc  = boost::context::detail;
   namespace bco = boost::coroutines;
-  typedef bco::stack_allocator stack_allocator;
 #else
 # include <boost/coroutine/stack_context.hpp>
+# include <boost/assert.hpp>
+# include <boost/coroutine/protected_stack_allocator.hpp>
   namespace bc  = boost::context;
   namespace bco = boost::coroutines;
-# if !defined(NDEBUG)
-#  include <boost/assert.hpp>
-#  include <boost/coroutine/protected_stack_allocator.hpp>
-  typedef bco::protected_stack_allocator stack_allocator;
-# else
-#  include <boost/coroutine/stack_allocator.hpp>
-  typedef bco::stack_allocator stack_allocator;
-# endif
-
 #endif // BOOST_VERSION >= 106100
 
+// fiber stacks are mmap'ed with a guard page below them, so an overflow faults
+// instead of silently corrupting the neighbouring allocation
+typedef bco::protected_stack_allocator stack_allocator;
+
 namespace fc {
   class thread;
   class promise_base;
   class task_base;
 
+  /**
+   *  Unused fiber stacks of one thread, one bucket per stack_size_class, so that
+   *  starting a fiber usually does not have to map a new stack.  Only the owning
+   *  thread allocates and frees stacks, the counters may be read from any thread.
+   */
+  class fiber_stack_pool {
+    public:
+      enum { class_count = 3, default_max_cached = 16 };
+
+      fiber_stack_pool()
+      :hits(0),misses(0),cached(0)
+      {
+        for( uint32_t& limit : max_cached )
+          limit = default_max_cached;
+      }
+
+      ~fiber_stack_pool()
+      {
+        for( auto& bucket : free_stacks )
+          for( bco::stack_context& stack : bucket )
+            alloc.deallocate( stack );
+      }
+
+      static size_t index( stack_size_class c ) { return static_cast<size_t>(c); }
+
+      static size_t stack_size( stack_size_class c )
+      {
+        switch( c )
+        {
+          case stack_size_class::compact: return FC_CONTEXT_SMALL_STACK_SIZE;
+          case stack_size_class::large:   return FC_CONTEXT_LARGE_STACK_SIZE;
+          default:                        return FC_CONTEXT_STACK_SIZE;
+        }
+      }
+
+      uint32_t limit( stack_size_class c )const { return max_cached[index(c)]; }
+
+      void allocate( stack_size_class c, bco::stack_context& stack )
+      {
+        auto& bucket = free_stacks[index(c)];
+        if( !bucket.empty() )
+        {
+          stack = bucket.back();
+          bucket.pop_back();
+          --cached;
+          ++hits;
+          return;
+        }
+        ++misses;
+        alloc.allocate( stack, stack_size(c) );
+      }
+
+      void deallocate( stack_size_class c, bco::stack_context& stack )
+      {
+        auto& bucket = free_stacks[index(c)];
+        if( bucket.size() < max_cached[index(c)] )
+        {
+          bucket.push_back( stack );
+          ++cached;
+        }
+        else
+          alloc.deallocate( stack );
+      }
+
+      void configure( stack_size_class c, uint32_t max_count, uint32_t preallocate )
+      {
+        auto& bucket = free_stacks[index(c)];
+        max_cached[index(c)] = max_count;
+        while( bucket.size() > max_count )
+        {
+          alloc.deallocate( bucket.back() );
+          bucket.pop_back();
+          --cached;
+        }
+        while( bucket.size() < std::min( preallocate, max_count ) )
+        {
+          bco::stack_context stack;
+          alloc.allocate( stack, stack_size(c) );
+          bucket.push_back( stack );
+          ++cached;
+        }
+      }
+
+      stack_pool_stats stats()const
+      {
+        stack_pool_stats result;
+        result.hits   = hits.load( boost::memory_order_relaxed );
+        result.misses = misses.load( boost::memory_order_relaxed );
+        result.cached = cached.load( boost::memory_order_relaxed );
+        return result;
+      }
+
+    private:
+      stack_allocator                 alloc;
+      std::vector<bco::stack_context> free_stacks[class_count];
+      uint32_t                        max_cached[class_count];
+      boost::atomic<uint64_t>         hits;
+      boost::atomic<uint64_t>         misses;
+      boost::atomic<uint32_t>         cached;
+  };
+
   /**
    *  maintains information associated with each context such as
    *  where it is blocked, what time it should resume, priority,
@@ -54,12 +154,14 @@ namespace fc {
     using context_fn = void(*)(intptr_t);
 #endif
 
-    context( context_fn sf, stack_allocator& alloc, fc::thread* t )
+    context( context_fn sf, fiber_stack_pool& pool, stack_size_class c, fc::thread* t )
     : caller_context(0),
-      stack_alloc(&alloc),
+      stack_pool(&pool),
+      stack_class(c),
       next_blocked(0), 
       next_blocked_mutex(0), 
       next(0), 
+      sleep_heap_index(size_t(-1)),
       ctx_thread(t),
       canceled(false),
 #ifndef NDEBUG
@@ -69,18 +171,19 @@ namespace fc {
       cur_task(0),
       context_posted_num(0)
     {
-     size_t stack_size = FC_CONTEXT_STACK_SIZE;
-     alloc.allocate(stack_ctx, stack_size);
+     pool.allocate(stack_class, stack_ctx);
      my_context = bc::make_fcontext( stack_ctx.sp, stack_ctx.size, sf); 
     }
 
     context( fc::thread* t) :
      my_context(nullptr),
      caller_context(0),
-     stack_alloc(0),
+     stack_pool(0),
+     stack_class(stack_size_class::normal), // runs on the stack of the native thread
      next_blocked(0), 
      next_blocked_mutex(0), 
      next(0), 
+     sleep_heap_index(size_t(-1)),
      ctx_thread(t),
      canceled(false),
 #ifndef NDEBUG
@@ -92,8 +195,8 @@ namespace fc {
     {}
 
     ~context() {
-      if(stack_alloc)
-        stack_alloc->deallocate( stack_ctx );
+      if(stack_pool)
+        stack_pool->deallocate( stack_class, stack_ctx );
     }
 
     void reinitialize()
@@ -182,7 +285,8 @@ namespace fc {
 
     bc::fcontext_t               my_context;
     fc::context*                caller_context;
-    stack_allocator*            stack_alloc;
+    fiber_stack_pool*           stack_pool;
+    stack_size_class             stack_class;
     priority                     prio;
     //promise_base*              prom; 
     std::vector<blocked_promise> blocking_prom;
@@ -191,6 +295,7 @@ namespace fc {
     fc::context*                next_blocked;
     fc::context*                next_blocked_mutex;
     fc::context*                next;
+    size_t                       sleep_heap_index; // position in the thread's sleep_pqueue, or size_t(-1)
     fc::thread*                 ctx_thread;
     bool                         canceled;
 #ifndef NDEBUG
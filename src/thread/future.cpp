@@ -131,6 +131,19 @@ namespace fc {
         hdl->on_complete( s, std::atomic_load( &_exceptp ) );
   }
 
+  void promise_base::_reset() {
+     _ready.store( false );
+     _blocked_thread.store( nullptr );
+     _blocked_fiber_count.store( 0 );
+     _timeout = time_point::maximum();
+     std::atomic_store( &_exceptp, fc::exception_ptr() );
+     _canceled = false;
+#ifndef NDEBUG
+     _cancellation_reason = nullptr;
+#endif
+     delete _compl.exchange( nullptr );
+  }
+
   void promise_base::_on_complete( detail::completion_handler* c ) {
      auto* hdl = _compl.load();
      while( !_compl.compare_exchange_weak( hdl, c ) );
@@ -0,0 +1,128 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+namespace fc {
+
+   /**
+    *  A binary heap of pointers where every element remembers its own position
+    *  in the heap.  This lets the thread remove an arbitrary sleeping context or
+    *  scheduled task in O(log n), where a plain std::vector heap needs a linear
+    *  search followed by std::make_heap().
+    *
+    *  @tparam T     the (pointer) type stored in the heap
+    *  @tparam Less  ordering in the same sense as std::push_heap(), front() is
+    *                the element no other element compares greater than
+    *  @tparam Index functor returning a reference to the size_t inside an
+    *                element that holds its position, npos while not queued
+    */
+   template<typename T, typename Less, typename Index>
+   class indexed_heap
+   {
+      public:
+         static const size_t npos = size_t(-1);
+
+         typedef typename std::vector<T>::const_iterator const_iterator;
+
+         bool           empty()const { return _heap.empty(); }
+         size_t         size()const  { return _heap.size();  }
+         T              front()const { return _heap.front(); }
+         const_iterator begin()const { return _heap.begin(); }
+         const_iterator end()const   { return _heap.end();   }
+
+         bool contains( T v )const { return Index()( v ) != npos; }
+
+         /** Adds v to the heap, or restores its position if v is already queued
+          *  and its key has changed. */
+         void push( T v )
+         {
+            size_t& pos = Index()( v );
+            if( pos != npos )
+            {
+               sift_up( pos );
+               sift_down( Index()( v ) );
+               return;
+            }
+            pos = _heap.size();
+            _heap.push_back( v );
+            sift_up( pos );
+         }
+
+         T pop_front()
+         {
+            T top = _heap.front();
+            remove_at( 0 );
+            return top;
+         }
+
+         /** Removes v from the heap, does nothing if v is not queued. */
+         void erase( T v )
+         {
+            size_t pos = Index()( v );
+            if( pos != npos )
+               remove_at( pos );
+         }
+
+         void clear()
+         {
+            for( T v : _heap )
+               Index()( v ) = npos;
+            _heap.clear();
+         }
+
+      private:
+         void place( T v, size_t pos )
+         {
+            _heap[pos] = v;
+            Index()( v ) = pos;
+         }
+
+         void remove_at( size_t pos )
+         {
+            Index()( _heap[pos] ) = npos;
+            T last = _heap.back();
+            _heap.pop_back();
+            if( pos == _heap.size() )
+               return;
+            place( last, pos );
+            sift_up( pos );
+            sift_down( Index()( last ) );
+         }
+
+         void sift_up( size_t pos )
+         {
+            T v = _heap[pos];
+            while( pos > 0 )
+            {
+               size_t parent = (pos - 1) / 2;
+               if( !Less()( _heap[parent], v ) )
+                  break;
+               place( _heap[parent], pos );
+               pos = parent;
+            }
+            place( v, pos );
+         }
+
+         void sift_down( size_t pos )
+         {
+            T v = _heap[pos];
+            const size_t count = _heap.size();
+            for(;;)
+            {
+               size_t child = 2 * pos + 1;
+               if( child >= count )
+                  break;
+               if( child + 1 < count && Less()( _heap[child], _heap[child + 1] ) )
+                  ++child;
+               if( !Less()( v, _heap[child] ) )
+                  break;
+               place( _heap[child], pos );
+               pos = child;
+            }
+            place( v, pos );
+         }
+
+         std::vector<T> _heap;
+   };
+
+} // namespace fc
@@ -23,48 +23,168 @@
  */
 
 #include <fc/thread/parallel.hpp>
-#include <fc/thread/spin_yield_lock.hpp>
-#include <fc/thread/unique_lock.hpp>
+#include <fc/thread/spin_lock.hpp>
 #include <fc/asio.hpp>
 
 #include <boost/atomic/atomic.hpp>
-#include <boost/lockfree/queue.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <deque>
 
 namespace fc {
    namespace detail {
+      /** A worker's local task queue. The owning worker pushes and pops at the
+       *  back, so that tasks spawned from inside a worker run LIFO and hit warm
+       *  caches. Other workers steal from the front.
+       */
+      class worker_deque
+      {
+         /** Spins briefly, then gives up the CPU so that a preempted lock holder can finish.
+          *  With must_lock == false it gives up immediately if the lock is taken.
+          */
+         class queue_guard
+         {
+         public:
+            explicit queue_guard( fc::spin_lock& l, bool must_lock = true ) : _lock( l ), _locked( true )
+            {
+               for( uint32_t i = 0; !_lock.try_lock(); i++ )
+               {
+                  if( !must_lock )
+                  {
+                     _locked = false;
+                     return;
+                  }
+                  if( i >= 16 )
+                     boost::this_thread::yield();
+               }
+            }
+            ~queue_guard() { if( _locked ) _lock.unlock(); }
+            operator bool()const { return _locked; }
+         private:
+            fc::spin_lock& _lock;
+            bool           _locked;
+         };
+
+      public:
+         worker_deque() : size( 0 ) {}
+         worker_deque( const worker_deque& ) : size( 0 ) {}
+
+         void push_back( task_base* task )
+         {
+            queue_guard lock( queue_lock );
+            tasks.push_back( task );
+            size.store( tasks.size(), boost::memory_order_relaxed );
+         }
+
+         /** @param more set to true if the queue still holds tasks afterwards */
+         task_base* pop_back( bool& more )
+         {
+            if( empty() )
+               return nullptr;
+            queue_guard lock( queue_lock );
+            if( tasks.empty() )
+               return nullptr;
+            task_base* task = tasks.back();
+            tasks.pop_back();
+            size.store( tasks.size(), boost::memory_order_relaxed );
+            more = !tasks.empty();
+            return task;
+         }
+
+         /** @param must_lock if false, give up when the queue is contended
+          *  @param more set to true if the queue still holds tasks afterwards
+          */
+         task_base* steal_front( bool must_lock, bool& more )
+         {
+            if( empty() )
+               return nullptr;
+            queue_guard lock( queue_lock, must_lock );
+            if( !lock || tasks.empty() )
+               return nullptr;
+            task_base* task = tasks.front();
+            tasks.pop_front();
+            size.store( tasks.size(), boost::memory_order_relaxed );
+            more = !tasks.empty();
+            return task;
+         }
+
+         /** Lock-free hint, callers that must not miss a task issue a fence first */
+         bool empty()const
+         {
+            return size.load( boost::memory_order_relaxed ) == 0;
+         }
+
+         template<typename Callback>
+         void consume_all( Callback&& cb )
+         {
+            queue_guard lock( queue_lock );
+            for( task_base* t : tasks )
+               cb( t );
+            tasks.clear();
+            size.store( 0, boost::memory_order_relaxed );
+         }
+
+      private:
+         fc::spin_lock            queue_lock;
+         std::deque<task_base*>   tasks;
+         boost::atomic<uint32_t>  size;
+      };
+
       class idle_notifier_impl : public thread_idle_notifier
       {
       public:
+         enum worker_state { busy_state, searching_state, parked_state };
+
          idle_notifier_impl()
          {
-            is_idle.store(false);
+            state.store( busy_state );
          }
 
          idle_notifier_impl( const idle_notifier_impl& copy )
          {
             id = copy.id;
             my_pool = copy.my_pool;
-            is_idle.store( copy.is_idle.load() );
+            state.store( copy.state.load() );
          }
 
          virtual ~idle_notifier_impl() {}
 
          virtual task_base* idle();
-         virtual void       busy()
-         {
-            is_idle.store(false);
-         }
+         virtual void       busy();
 
          uint32_t            id;
          pool_impl*          my_pool;
-         boost::atomic<bool> is_idle;
+         boost::atomic<int>  state;
       };
 
+      /** @return the notifier of the pool worker running on the current thread, if any */
+      static idle_notifier_impl*& current_worker()
+      {
+#ifdef _MSC_VER
+         static __declspec(thread) idle_notifier_impl* w = nullptr;
+#else
+         static __thread idle_notifier_impl* w = nullptr;
+#endif
+         return w;
+      }
+
+      /** Work-stealing pool. Every worker owns a deque. Tasks posted from inside
+       *  a worker stay in that worker's deque. Tasks posted from outside the pool
+       *  are handed to a parked worker if nobody is looking for work, otherwise
+       *  they are distributed round-robin over the deques. Idle workers first
+       *  drain their own deque, then steal from the others, and park when there
+       *  is nothing left.
+       *
+       *  A parked worker is only woken if no other worker is currently looking
+       *  for work, which keeps bursts of posts from waking every thread.
+       */
       class pool_impl
       {
       public:
          explicit pool_impl( const uint16_t num_threads )
-            : idle_threads( 2 * num_threads ), waiting_tasks( 200 )
+            : queues( num_threads ), next_queue( 0 ), next_worker( 0 ), searching( 0 ),
+              // spinning only pays off if another core can produce work in the meantime
+              idle_spin_rounds( boost::thread::hardware_concurrency() > 1 ? 64 : 0 )
          {
             notifiers.resize( num_threads );
             threads.reserve( num_threads );
@@ -79,56 +199,136 @@ namespace fc {
          {
             for( thread* t : threads)
                delete t; // also calls quit()
-            waiting_tasks.consume_all( [] ( task_base* t ) {
-               t->cancel( "thread pool quitting" );
-            });
+            for( worker_deque& q : queues )
+               q.consume_all( [] ( task_base* t ) {
+                  t->cancel( "thread pool quitting" );
+               });
          }
 
+         /** @return a parked worker the task should be handed to directly, or nullptr if it was queued */
          thread* post( task_base* task )
          {
-            idle_notifier_impl* ini;
-            while( idle_threads.pop( ini ) )
-               if( ini->is_idle.exchange( false ) )
-               { // minor race condition here, a thread might receive a task while it's busy
-                  return threads[ini->id];
-               }
-            boost::unique_lock<fc::spin_yield_lock> lock(pool_lock);
-            while( idle_threads.pop( ini ) )
-               if( ini->is_idle.exchange( false ) )
-               { // minor race condition here, a thread might receive a task while it's busy
+            idle_notifier_impl* self = current_worker();
+            if( self && self->my_pool == this )
+               queues[self->id].push_back( task );
+            else
+            {
+               // if nobody is looking for work, hand the task to a parked worker directly
+               idle_notifier_impl* ini = searching.load() > 0 ? nullptr
+                                         : claim_parked_worker( idle_notifier_impl::busy_state );
+               if( ini )
                   return threads[ini->id];
-               }
-            while( !waiting_tasks.push( task ) )
-               elog( "Worker pool internal error" );
-            return 0;
+               queues[next_queue.fetch_add( 1, boost::memory_order_relaxed ) % queues.size()].push_back( task );
+            }
+
+            // Pairs with the fence in idle(): either a worker that stops searching
+            // sees the new task in its final scan, or we see that nobody is searching.
+            boost::atomic_thread_fence( boost::memory_order_seq_cst );
+            if( searching.load() <= 0 )
+               wake_parked_worker();
+            return nullptr;
          }
 
-         task_base* enqueue_idle_thread( idle_notifier_impl* ini )
+         idle_notifier_impl* claim_parked_worker( idle_notifier_impl::worker_state new_state )
          {
-            task_base* task;
-            if( waiting_tasks.pop( task ) )
-               return task;
-            fc::unique_lock<fc::spin_yield_lock> lock(pool_lock);
-            if( waiting_tasks.pop( task ) )
+            // rotate the starting point so that the same worker isn't picked over and over
+            const uint32_t start = next_worker.fetch_add( 1, boost::memory_order_relaxed );
+            for( size_t i = 0; i < notifiers.size(); i++ )
+            {
+               idle_notifier_impl& ini = notifiers[(start + i) % notifiers.size()];
+               int expected = idle_notifier_impl::parked_state;
+               if( ini.state.load( boost::memory_order_relaxed ) == expected
+                     && ini.state.compare_exchange_strong( expected, new_state ) )
+                  return &ini;
+            }
+            return nullptr;
+         }
+
+         void wake_parked_worker()
+         {
+            idle_notifier_impl* ini = claim_parked_worker( idle_notifier_impl::searching_state );
+            if( ini )
+            {
+               searching.fetch_add( 1 );
+               threads[ini->id]->poke();
+            }
+         }
+
+         task_base* find_work( const idle_notifier_impl* ini, bool must_lock, bool& more )
+         {
+            task_base* task = queues[ini->id].pop_back( more );
+            for( size_t i = 1; !task && i < queues.size(); i++ )
+               task = queues[(ini->id + i) % queues.size()].steal_front( must_lock, more );
+            return task;
+         }
+
+         /** @return true if any deque's size hint says it holds tasks */
+         bool work_queued()const
+         {
+            for( const worker_deque& queue : queues )
+               if( !queue.empty() )
+                  return true;
+            return false;
+         }
+
+         task_base* idle( idle_notifier_impl* ini )
+         {
+            if( ini->state.exchange( idle_notifier_impl::searching_state ) != idle_notifier_impl::searching_state )
+               searching.fetch_add( 1 );
+
+            bool more = false;
+            task_base* task = find_work( ini, false, more );
+            for( uint32_t round = 0; !task && round < idle_spin_rounds; round++ )
+            {
+               boost::this_thread::yield();
+               task = find_work( ini, false, more );
+            }
+            if( task )
+            {
+               ini->state.store( idle_notifier_impl::busy_state );
+               // if the last searcher leaves work behind in any deque, get somebody else to look for it
+               if( searching.fetch_sub( 1 ) == 1 && ( more || work_queued() ) )
+                  wake_parked_worker();
                return task;
-            while( !idle_threads.push( ini ) )
-               elog( "Worker pool internal error" );
-            return 0;
+            }
+
+            ini->state.store( idle_notifier_impl::parked_state );
+            searching.fetch_sub( 1 );
+            boost::atomic_thread_fence( boost::memory_order_seq_cst );
+            return find_work( ini, true, more ); // busy() sorts out the state if we got something
+         }
+
+         uint16_t num_threads()const
+         {
+            return threads.size();
+         }
+
+         void busy( idle_notifier_impl* ini )
+         {
+            if( ini->state.exchange( idle_notifier_impl::busy_state ) == idle_notifier_impl::searching_state )
+               searching.fetch_sub( 1 ); // woken up by wake_parked_worker()
          }
       private:
-         std::vector<idle_notifier_impl>                notifiers;
-         std::vector<thread*>                           threads;
-         boost::lockfree::queue<idle_notifier_impl*>    idle_threads;
-         boost::lockfree::queue<task_base*>             waiting_tasks;
-         fc::spin_yield_lock                            pool_lock;
+         std::vector<idle_notifier_impl>  notifiers;
+         std::vector<thread*>             threads;
+         std::vector<worker_deque>        queues;
+         boost::atomic<uint32_t>          next_queue;
+         boost::atomic<uint32_t>          next_worker;
+         /// number of workers that are looking for work or have been woken up to do so
+         boost::atomic<int32_t>           searching;
+         /// number of rounds an idle worker scans the queues before it parks
+         const uint32_t                   idle_spin_rounds;
       };
 
       task_base* idle_notifier_impl::idle()
       {
-         is_idle.store( true );
-         task_base* result = my_pool->enqueue_idle_thread( this );
-         if( result ) is_idle.store( false );
-         return result;
+         current_worker() = this;
+         return my_pool->idle( this );
+      }
+
+      void idle_notifier_impl::busy()
+      {
+         my_pool->busy( this );
       }
 
       worker_pool::worker_pool()
@@ -149,6 +349,11 @@ namespace fc {
              worker->async_task( task, priority() );
       }
 
+      uint16_t worker_pool::num_threads()const
+      {
+         return my->num_threads();
+      }
+
       worker_pool& get_worker_pool()
       {
          static worker_pool the_pool;
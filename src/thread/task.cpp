@@ -18,6 +18,10 @@ namespace fc {
   :
   promise_base("task_base"),
   _posted_num(0),
+  _create_time(time_point::now()),
+  _stack_class(stack_size_class::normal),
+  _sch_index(size_t(-1)),
+  _scheduled_in(nullptr),
   _active_context(nullptr),
   _next(nullptr),
   _task_specific_data(nullptr),
@@ -77,6 +81,12 @@ namespace fc {
 #endif
       _active_context->ctx_thread->notify_task_has_been_canceled();
     }
+    else if (_scheduled_in && !ready())
+    {
+      // not started yet, have the thread take it out of its scheduled task heap now
+      // rather than when its start time arrives
+      _scheduled_in->notify_task_has_been_canceled(this);
+    }
   }
 
   task_base::~task_base() {
@@ -1,9 +1,11 @@
 #include <fc/thread/thread.hpp>
 #include <fc/io/sstream.hpp>
 #include <fc/log/logger.hpp>
+#include <fc/thread/thread_stats.hpp>
 #include "thread_d.hpp"
 
 #include <iostream>
+#include <map>
 
 #if defined(_MSC_VER) && !defined(NDEBUG)
 # include <windows.h>
@@ -215,11 +217,13 @@ namespace fc {
 
 
     // move all sleep tasks to ready
-    for( uint32_t i = 0; i < my->sleep_pqueue.size(); ++i )
-      my->add_context_to_ready_list( my->sleep_pqueue[i] );
+    for (fc::context* sleeping_context : my->sleep_pqueue)
+      my->add_context_to_ready_list( sleeping_context );
     my->sleep_pqueue.clear();
 
     // move all idle tasks to ready
+    for( uint32_t& count : my->parked_count )
+      count = 0;
     fc::context* cur = my->pt_head;
     while( cur )
     {
@@ -261,6 +265,64 @@ namespace fc {
       my->current = 0;
    }
 
+   void thread::configure_stack_pool( stack_size_class c, uint32_t max_cached, uint32_t preallocate )
+   {
+      if( !is_current() )
+      {
+        async( [=](){ configure_stack_pool( c, max_cached, preallocate ); }, "configure_stack_pool" ).wait();
+        return;
+      }
+      my->stack_pool.configure( c, max_cached, preallocate );
+   }
+
+   stack_pool_stats thread::get_stack_pool_stats()const
+   {
+      return my->stack_pool.stats();
+   }
+
+   thread_stats thread::get_stats()const
+   {
+      thread_stats result;
+      result.name                   = my->name;
+      result.task_queue_depth       = my->task_queue_depth.load( boost::memory_order_relaxed );
+      result.scheduled_task_count   = my->scheduled_task_count.load( boost::memory_order_relaxed );
+      result.ready_context_count    = my->ready_context_count.load( boost::memory_order_relaxed );
+      result.sleeping_context_count = my->sleeping_context_count.load( boost::memory_order_relaxed );
+      result.tasks_run              = my->tasks_run.load( boost::memory_order_relaxed );
+      result.context_switches       = my->context_switches.load( boost::memory_order_relaxed );
+      result.stack_pool             = my->stack_pool.stats();
+
+      // tasks created from different call sites may share a description
+      std::map<std::string, task_latency_stats> by_desc;
+      {
+        boost::unique_lock<boost::mutex> lock( my->task_latency_mutex );
+        for( const auto& item : my->task_latency )
+        {
+          const detail::task_latency_counters& counters = *item.second;
+          task_latency_stats& stats = by_desc[ item.first ? item.first : "" ];
+          stats.count    += counters.count.load( boost::memory_order_relaxed );
+          stats.total_us += counters.total_us.load( boost::memory_order_relaxed );
+          stats.max_us    = std::max( stats.max_us, counters.max_us.load( boost::memory_order_relaxed ) );
+          stats.buckets.resize( detail::task_latency_counters::bucket_count );
+          for( uint32_t i = 0; i < detail::task_latency_counters::bucket_count; ++i )
+            stats.buckets[i] += counters.buckets[i].load( boost::memory_order_relaxed );
+        }
+      }
+      result.task_latency.reserve( by_desc.size() );
+      for( auto& item : by_desc )
+      {
+        item.second.desc = item.first;
+        result.task_latency.push_back( std::move( item.second ) );
+      }
+      return result;
+   }
+
+   const std::vector<uint64_t>& task_latency_stats::bucket_limits()
+   {
+      static const std::vector<uint64_t> limits{ 10, 100, 1000, 10000, 100000, 1000000 };
+      return limits;
+   }
+
    bool thread::is_running()const
    {
       return !my->done;
@@ -312,14 +374,12 @@ namespace fc {
        if( timeout != time_point::maximum() )
        {
            my->current->resume_time = timeout;
-           my->sleep_pqueue.push_back(my->current);
-           std::push_heap( my->sleep_pqueue.begin(),
-                           my->sleep_pqueue.end(),
-                           sleep_priority_less()   );
+           my->sleep_pqueue.push(my->current);
        }
 
        my->add_to_blocked( my->current );
        my->start_next_fiber();
+       my->sleep_pqueue.erase( my->current );
 
        for( auto i = p.begin(); i != p.end(); ++i )
          my->current->remove_blocking_promise(i->get());
@@ -338,6 +398,9 @@ namespace fc {
    }
 
    void thread::poke() {
+     boost::atomic_thread_fence( boost::memory_order_seq_cst );
+     if( !my->parked.load( boost::memory_order_relaxed ) )
+       return; // not waiting, it will look for work before it parks
      boost::unique_lock<boost::mutex> lock(my->task_ready_mutex);
      my->task_ready.notify_one();
    }
@@ -349,16 +412,24 @@ namespace fc {
          FC_THROW_EXCEPTION( canceled_exception, "Thread is not running.");
       }
       t->_when = tp;
+      if( tp != time_point::min() )
+        t->_scheduled_in = this;
       task_base* stale_head = my->task_in_queue.load(boost::memory_order_relaxed);
       do { t->_next = stale_head;
       }while( !my->task_in_queue.compare_exchange_weak( stale_head, t, boost::memory_order_release ) );
 
-      // Because only one thread can post the 'first task', only that thread will attempt
-      // to aquire the lock and therefore there should be no contention on this lock except
-      // when *this thread is about to block on a wait condition.
-      if( this != &current() &&  !stale_head ) {
-          boost::unique_lock<boost::mutex> lock(my->task_ready_mutex);
-          my->task_ready.notify_one();
+      // Only the thread that posts the 'first task' into an empty queue may have to wake
+      // the consumer, and only if the consumer is parked on task_ready (or about to be).
+      // The fence pairs with the one in parked_scope: either this thread sees 'parked',
+      // or the consumer sees the new task before it waits.  A busy consumer therefore
+      // costs producers no lock at all.
+      if( this != &current() && !stale_head ) {
+          boost::atomic_thread_fence( boost::memory_order_seq_cst );
+          if( my->parked.load( boost::memory_order_relaxed ) )
+          {
+             boost::unique_lock<boost::mutex> lock(my->task_ready_mutex);
+             my->task_ready.notify_one();
+          }
       }
    }
 
@@ -404,15 +475,13 @@ namespace fc {
          if( timeout != time_point::maximum() )
          {
              my->current->resume_time = timeout;
-             my->sleep_pqueue.push_back(my->current);
-             std::push_heap( my->sleep_pqueue.begin(),
-                             my->sleep_pqueue.end(),
-                             sleep_priority_less() );
+             my->sleep_pqueue.push(my->current);
          }
 
          my->add_to_blocked( my->current );
 
          my->start_next_fiber();
+         my->sleep_pqueue.erase( my->current );
 
          my->current->remove_blocking_promise(p.get());
 
@@ -443,16 +512,10 @@ namespace fc {
           // remove it from the blocked list.
 
           // remove this context from the sleep queue...
-          for( uint32_t i = 0; i < my->sleep_pqueue.size(); ++i )
+          if( my->sleep_pqueue.contains( cur_blocked ) )
           {
-            if( my->sleep_pqueue[i] == cur_blocked )
-            {
-              my->sleep_pqueue[i]->blocking_prom.clear();
-              my->sleep_pqueue[i] = my->sleep_pqueue.back();
-              my->sleep_pqueue.pop_back();
-              std::make_heap( my->sleep_pqueue.begin(),my->sleep_pqueue.end(), sleep_priority_less() );
-              break;
-            }
+            cur_blocked->blocking_prom.clear();
+            my->sleep_pqueue.erase( cur_blocked );
           }
           auto cur = cur_blocked;
           if( prev_blocked )
@@ -486,6 +549,18 @@ namespace fc {
       async( [this](){ my->notify_task_has_been_canceled(); }, "notify_task_has_been_canceled", priority::max() );
     }
 
+    void thread::notify_task_has_been_canceled( task_base* t )
+    {
+      if( !is_running() )
+        return; // quit() fails all scheduled tasks anyway
+      promise_base::ptr keep_alive = t->shared_from_this();
+      if( is_current() )
+        my->remove_canceled_scheduled_task( t );
+      else
+        async( [this,t,keep_alive](){ my->remove_canceled_scheduled_task( t ); },
+               "notify_task_has_been_canceled", priority::max() );
+    }
+
     void thread::unblock(fc::context* c)
     {
       my->unblock(c);
@@ -3,11 +3,14 @@
 #include <fc/time.hpp>
 #include <boost/thread.hpp>
 #include "context.hpp"
+#include "indexed_heap.hpp"
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread.hpp>
 #include <boost/atomic.hpp>
 
+#include <memory>
 #include <sstream>
+#include <unordered_map>
 #include <vector>
 
 namespace fc {
@@ -16,8 +19,66 @@ namespace fc {
             return a->resume_time > b->resume_time;
         }
     };
+    struct sleep_heap_index {
+        size_t& operator()( context* c )const { return c->sleep_heap_index; }
+    };
 
     namespace detail {
+       /** Increments a counter that only one thread writes, but any thread may read */
+       inline void bump( boost::atomic<uint64_t>& counter, uint64_t amount = 1 )
+       {
+          counter.store( counter.load( boost::memory_order_relaxed ) + amount, boost::memory_order_relaxed );
+       }
+
+       /** Start latency of the tasks with one description, see thread::get_stats() */
+       struct task_latency_counters {
+          enum { bucket_count = 7 }; // < 10us, 100us, 1ms, 10ms, 100ms, 1s, and the rest
+
+          task_latency_counters()
+          :count(0),total_us(0),max_us(0)
+          {
+             for( auto& bucket : buckets )
+                bucket.store( 0, boost::memory_order_relaxed );
+          }
+
+          void record( uint64_t latency_us )
+          {
+             bump( count );
+             bump( total_us, latency_us );
+             if( latency_us > max_us.load( boost::memory_order_relaxed ) )
+                max_us.store( latency_us, boost::memory_order_relaxed );
+             uint32_t bucket = 0;
+             for( uint64_t limit = 10; bucket + 1 < bucket_count && latency_us >= limit; limit *= 10 )
+                ++bucket;
+             bump( buckets[bucket] );
+          }
+
+          boost::atomic<uint64_t> count;
+          boost::atomic<uint64_t> total_us;
+          boost::atomic<uint64_t> max_us;
+          boost::atomic<uint64_t> buckets[bucket_count];
+       };
+
+       /**
+        *  Marks the thread as parked on task_ready for as long as it's in scope, so
+        *  producers know they must signal it.  Includes the fence that pairs with the
+        *  one in thread::async_task().
+        */
+       class parked_scope {
+       public:
+          explicit parked_scope( boost::atomic<bool>& flag ) : parked(flag)
+          {
+             parked.store( true, boost::memory_order_relaxed );
+             boost::atomic_thread_fence( boost::memory_order_seq_cst );
+          }
+          ~parked_scope()
+          {
+             parked.store( false, boost::memory_order_relaxed );
+          }
+       private:
+          boost::atomic<bool>& parked;
+       };
+
        class idle_guard {
        public:
           explicit idle_guard( thread_d* t );
@@ -32,20 +93,45 @@ namespace fc {
         public:
            using context_pair = std::pair<thread_d*, fc::context*>;
 
+          struct task_when_less 
+          {
+            bool operator()( task_base* a, task_base* b ) 
+            {
+              return a->_when > b->_when;
+            }
+          };
+          struct task_sch_index
+          {
+            size_t& operator()( task_base* t )const { return t->_sch_index; }
+          };
+          typedef indexed_heap<task_base*, task_when_less, task_sch_index>   task_sch_heap;
+          typedef indexed_heap<fc::context*, sleep_priority_less, sleep_heap_index> sleep_heap;
+
            thread_d( fc::thread& s, thread_idle_notifier* n = 0 )
             :self(s), boost_thread(0),
              task_in_queue(0),
+             parked(false),
              next_posted_num(1),
              done(false),
              current(0),
              pt_head(0),
              blocked(0),
              next_unused_task_storage_slot(0),
-             notifier(n)
+             notifier(n),
+             task_queue_depth(0),
+             scheduled_task_count(0),
+             ready_context_count(0),
+             sleeping_context_count(0),
+             tasks_run(0),
+             context_switches(0),
+             last_latency_desc(nullptr),
+             last_latency_counters(nullptr)
 #ifndef NDEBUG
              ,non_preemptable_scope_count(0)
 #endif
             { 
+              for( uint32_t& count : parked_count )
+                count = 0;
               static boost::atomic<int> cnt(0);
               name = std::string("th_") + char('a'+cnt++); 
 //              printf("thread=%p\n",this);
@@ -66,6 +152,7 @@ namespace fc {
                   delete ready_context;
               }
               ready_heap.clear();
+              clear_free_list();
               while (blocked)
               {
                 temp = blocked->next;
@@ -90,15 +177,16 @@ namespace fc {
 
            fc::thread&             self;
            boost::thread* boost_thread;
-           stack_allocator                  stack_alloc;
+           fiber_stack_pool                 stack_pool;
            boost::condition_variable        task_ready;
            boost::mutex                     task_ready_mutex;
 
            boost::atomic<task_base*>       task_in_queue;
+           boost::atomic<bool>             parked;         // true while waiting on task_ready, producers only notify then
            std::vector<task_base*>         task_pqueue;    // heap of tasks that have never started, ordered by proirity & scheduling time
            uint64_t                        next_posted_num; // each task or context gets assigned a number in the order it is ready to execute, tracked here
-           std::vector<task_base*>         task_sch_queue; // heap of tasks that have never started but are scheduled for a time in the future, ordered by the time they should be run
-           std::vector<fc::context*>       sleep_pqueue;   // heap of running tasks that have sleeped, ordered by the time they should resume
+           task_sch_heap                   task_sch_queue; // heap of tasks that have never started but are scheduled for a time in the future, ordered by the time they should be run
+           sleep_heap                      sleep_pqueue;   // heap of running tasks that have sleeped, ordered by the time they should resume
            std::vector<fc::context*>       free_list;      // list of unused contexts that are ready for deletion
 
            bool                     done;
@@ -106,6 +194,7 @@ namespace fc {
            fc::context*             current;     // the currently-executing task in this thread
 
            fc::context*             pt_head;     // list of contexts that can be reused for new tasks
+           uint32_t                 parked_count[fiber_stack_pool::class_count]; // number of contexts in pt_head by stack class
 
            std::vector<fc::context*> ready_heap; // priority heap of contexts that are ready to run
 
@@ -121,6 +210,19 @@ namespace fc {
 
            thread_idle_notifier *notifier;
 
+           // scheduler counters for thread::get_stats(), written only by this thread
+           boost::atomic<uint32_t>  task_queue_depth;
+           boost::atomic<uint32_t>  scheduled_task_count;
+           boost::atomic<uint32_t>  ready_context_count;
+           boost::atomic<uint32_t>  sleeping_context_count;
+           boost::atomic<uint64_t>  tasks_run;
+           boost::atomic<uint64_t>  context_switches;
+           // keyed by the task's desc pointer, other threads must hold task_latency_mutex to read it
+           std::unordered_map<const char*, std::unique_ptr<detail::task_latency_counters>> task_latency;
+           boost::mutex             task_latency_mutex;
+           const char*              last_latency_desc;
+           detail::task_latency_counters* last_latency_counters;
+
 #ifndef NDEBUG
            unsigned                 non_preemptable_scope_count;
 #endif
@@ -179,6 +281,7 @@ namespace fc {
 
            void pt_push_back(fc::context* c) 
            {
+              ++parked_count[fiber_stack_pool::index(c->stack_class)];
               c->next = pt_head;
               pt_head = c;
               /* 
@@ -192,6 +295,46 @@ namespace fc {
               */
            }
 
+           /**
+            *  Takes the parked context with the smallest stack that is at least
+            *  min_class out of pt_head, or returns nullptr if there is none.
+            */
+           fc::context* pt_pop(stack_size_class min_class)
+           {
+              fc::context** best = nullptr;
+              for( fc::context** c = &pt_head; *c; c = &(*c)->next )
+              {
+                if( (*c)->stack_class < min_class )
+                  continue;
+                if( !best || (*c)->stack_class < (*best)->stack_class )
+                  best = c;
+                if( (*c)->stack_class == min_class )
+                  break;
+              }
+              if( !best )
+                return nullptr;
+              fc::context* result = *best;
+              *best = result->next;
+              result->next = nullptr;
+              --parked_count[fiber_stack_pool::index(result->stack_class)];
+              return result;
+           }
+
+           /**
+            *  The current fiber is out of work while another context is ready to run.
+            *  Park it in pt_head for reuse, unless enough fibers of its stack class are
+            *  parked already.  Returns false if the fiber should exit instead, which
+            *  hands its stack back to stack_pool.
+            */
+           bool park_current()
+           {
+              if( current->stack_pool &&
+                  parked_count[fiber_stack_pool::index(current->stack_class)] >= stack_pool.limit(current->stack_class) )
+                return false;
+              pt_push_back( current );
+              return true;
+           }
+
           fc::context::ptr ready_pop_front() 
           {
             fc::context* highest_priority_context = ready_heap.front();
@@ -236,14 +379,6 @@ namespace fc {
             }
           };
 
-          struct task_when_less 
-          {
-            bool operator()( task_base* a, task_base* b ) 
-            {
-              return a->_when > b->_when;
-            }
-          };
-
            void enqueue( task_base* t ) 
            {
               time_point now = time_point::now();
@@ -268,9 +403,7 @@ namespace fc {
               {
                 if (cur->_when > now)
                 {
-                  task_sch_queue.push_back(cur);
-                  std::push_heap(task_sch_queue.begin(),
-                                 task_sch_queue.end(), task_when_less());
+                  task_sch_queue.push(cur);
                 }
                 else
                 {
@@ -305,9 +438,7 @@ namespace fc {
             while (!task_sch_queue.empty() &&
                    task_sch_queue.front()->_when <= time_point::now())
             {
-              task_base* ready_task = task_sch_queue.front();
-              std::pop_heap(task_sch_queue.begin(), task_sch_queue.end(), task_when_less());
-              task_sch_queue.pop_back();
+              task_base* ready_task = task_sch_queue.pop_front();
 
               ready_task->_posted_num = next_posted_num++;
               task_pqueue.push_back(ready_task);
@@ -327,28 +458,20 @@ namespace fc {
                 return p;
            }
 
-           bool process_canceled_tasks()
+           /**
+            * Called (via thread::notify_task_has_been_canceled) when a task scheduled
+            * for a future time is canceled, completes it right away instead of
+            * leaving it in task_sch_queue until its start time.
+            */
+           void remove_canceled_scheduled_task( task_base* t )
            {
-              bool canceled_task = false;
-              for( auto task_itr = task_sch_queue.begin();
-                   task_itr != task_sch_queue.end();
-                   )
-              {
-                 if( (*task_itr)->canceled() )
-                 {
-                    (*task_itr)->run();
-                    (*task_itr)->release(); // HERE BE DRAGONS
-                    task_itr = task_sch_queue.erase(task_itr);
-                    canceled_task = true;
-                    continue;
-                 }
-                 ++task_itr;
-              }
-
-              if( canceled_task )  
-                 std::make_heap( task_sch_queue.begin(), task_sch_queue.end(), task_when_less() );
-
-              return canceled_task;
+              // a task scheduled from this thread since it last yielded is still in task_in_queue
+              move_newly_scheduled_tasks_to_task_pqueue();
+              if( !task_sch_queue.contains( t ) )
+                 return; // already started, it will notice the cancellation itself
+              task_sch_queue.erase( t );
+              t->run();
+              t->release(); // HERE BE DRAGONS
            }
            
            /**
@@ -429,6 +552,7 @@ namespace fc {
                 }
                 // slog( "jump to %p from %p", next, prev );
                 // fc_dlog( logger::get("fc_context"), "from ${from} to ${to}", ( "from", int64_t(prev) )( "to", int64_t(next) ) ); 
+                detail::bump( context_switches );
 #if BOOST_VERSION >= 106100
                 auto p = context_pair{nullptr, prev};
                 auto t = bc::jump_fcontext( next->my_context, &p );
@@ -446,19 +570,19 @@ namespace fc {
                 // that will process posted tasks...
                 fc::context* prev = current;
 
-                fc::context* next = nullptr;
-                if( pt_head ) 
+                // the new context will pick up the next task, so it needs a stack that's big enough for it
+                stack_size_class needed = task_pqueue.empty() ? stack_size_class::normal
+                                                              : task_pqueue.front()->_stack_class;
+                fc::context* next = pt_pop( needed );
+                if( next ) 
                 { 
                   // grab cached context
-                  next = pt_head;
-                  pt_head = pt_head->next;
-                  next->next = 0;
                   next->reinitialize();
                 } 
                 else 
                 { 
                   // create new context.
-                  next = new fc::context( &thread_d::start_process_tasks, stack_alloc,
+                  next = new fc::context( &thread_d::start_process_tasks, stack_pool, needed,
                                           &fc::thread::current() );
                 }
 
@@ -471,6 +595,7 @@ namespace fc {
 
                 // slog( "jump to %p from %p", next, prev );
                 // fc_dlog( logger::get("fc_context"), "from ${from} to ${to}", ( "from", int64_t(prev) )( "to", int64_t(next) ) );
+                detail::bump( context_switches );
 #if BOOST_VERSION >= 106100
                 auto p = context_pair{this, prev};
                 auto t = bc::jump_fcontext( next->my_context, &p );
@@ -526,9 +651,42 @@ namespace fc {
               self->start_next_fiber( false );
            }
 
+           void record_task_start( task_base* t )
+           {
+              detail::bump( tasks_run );
+
+              const char* desc = t->get_desc();
+              if( desc != last_latency_desc || !last_latency_counters )
+              {
+                 auto itr = task_latency.find( desc );
+                 if( itr == task_latency.end() )
+                 {
+                    boost::unique_lock<boost::mutex> lock( task_latency_mutex );
+                    itr = task_latency.emplace( desc, std::unique_ptr<detail::task_latency_counters>(
+                                                         new detail::task_latency_counters ) ).first;
+                 }
+                 last_latency_desc = desc;
+                 last_latency_counters = itr->second.get();
+              }
+
+              // scheduled tasks are late only once their start time has passed
+              time_point ready_since = t->_when > t->_create_time ? t->_when : t->_create_time;
+              int64_t latency = (time_point::now() - ready_since).count();
+              last_latency_counters->record( latency > 0 ? latency : 0 );
+           }
+
+           void publish_queue_depths()
+           {
+              task_queue_depth.store( task_pqueue.size(), boost::memory_order_relaxed );
+              scheduled_task_count.store( task_sch_queue.size(), boost::memory_order_relaxed );
+              ready_context_count.store( ready_heap.size(), boost::memory_order_relaxed );
+              sleeping_context_count.store( sleep_pqueue.size(), boost::memory_order_relaxed );
+           }
+
            void run_next_task() 
            {
               task_base* next = dequeue();
+              record_task_start( next );
 
               next->_set_active_context( current );
               current->cur_task = next;
@@ -559,11 +717,16 @@ namespace fc {
            {
               while( !done || blocked ) 
               {
+                // fibers that exited have handed control to us, their stacks can go back to the pool
+                if( !free_list.empty() )
+                  clear_free_list();
+
                 // move all new tasks to the task_pqueue
                 move_newly_scheduled_tasks_to_task_pqueue();
 
                 // move all now-ready sleeping tasks to the ready list
                 check_for_timeouts();
+                publish_queue_depths();
 
                 if (!task_pqueue.empty())
                 {
@@ -573,12 +736,22 @@ namespace fc {
                     if (task_priority_less()(task_pqueue.front(), ready_heap.front()))
                     {
                       // run the existing task first
-                      pt_push_back(current);
+                      if( !park_current() )
+                        return;
                       start_next_fiber(false);
                       continue;
                     }
                   }
 
+                  if (task_pqueue.front()->_stack_class > current->stack_class)
+                  {
+                    // the task needs a bigger stack than this fiber has, leave it to one that has it
+                    if( !park_current() )
+                      return;
+                    start_next_fiber(false);
+                    continue;
+                  }
+
                   // if we made it here, either there's no ready context, or the ready context is
                   // scheduled after the ready task, so we should run the task first
                   run_next_task();
@@ -589,14 +762,12 @@ namespace fc {
                 // process tasks... do it.
                 if (!ready_heap.empty())
                 { 
-                   pt_push_back( current ); 
+                   if( !park_current() )
+                     return;
                    start_next_fiber(false);  
                    continue;
                 }
 
-                if( process_canceled_tasks() ) 
-                  continue;
-
                 clear_free_list();
 
                 { // lock scope
@@ -608,6 +779,8 @@ namespace fc {
                   if( done ) 
                     return;
 
+                  // from here on, a producer that finds task_in_queue empty will signal task_ready
+                  detail::parked_scope parked_until_woken( parked );
                   detail::idle_guard guard( this );
                   if( task_in_queue.load(boost::memory_order_relaxed) )
                      continue;
@@ -668,10 +841,7 @@ namespace fc {
         // move all expired sleeping tasks to the ready queue
         while( sleep_pqueue.size() && sleep_pqueue.front()->resume_time < now ) 
         {
-          fc::context::ptr c = sleep_pqueue.front();
-          std::pop_heap(sleep_pqueue.begin(), sleep_pqueue.end(), sleep_priority_less() );
-          // ilog( "sleep pop back..." );
-          sleep_pqueue.pop_back();
+          fc::context::ptr c = sleep_pqueue.pop_front();
 
           if( c->blocking_prom.size() ) 
           {
@@ -716,24 +886,12 @@ namespace fc {
           current->resume_time = tp;
           current->clear_blocking_promises();
 
-          sleep_pqueue.push_back(current);
-          std::push_heap( sleep_pqueue.begin(),
-                          sleep_pqueue.end(), sleep_priority_less()   );
+          sleep_pqueue.push(current);
           
           start_next_fiber(reschedule);
 
           // clear current context from sleep queue...
-          for( uint32_t i = 0; i < sleep_pqueue.size(); ++i ) 
-          {
-            if( sleep_pqueue[i] == current ) 
-            {
-              sleep_pqueue[i] = sleep_pqueue.back();
-              sleep_pqueue.pop_back();
-              std::make_heap( sleep_pqueue.begin(),
-                              sleep_pqueue.end(), sleep_priority_less() );
-              break;
-            }
-          }
+          sleep_pqueue.erase(current);
 
           current->resume_time = time_point::maximum();
           check_fiber_exceptions();
@@ -759,10 +917,7 @@ namespace fc {
           if( timeout != time_point::maximum() ) 
           {
             current->resume_time = timeout;
-            sleep_pqueue.push_back(current);
-            std::push_heap( sleep_pqueue.begin(),
-                            sleep_pqueue.end(), 
-                            sleep_priority_less()   );
+            sleep_pqueue.push(current);
           }
 
           // elog( "blocking %1%", current );
@@ -771,6 +926,7 @@ namespace fc {
 
 
           start_next_fiber();
+          sleep_pqueue.erase(current);
           // slog( "resuming %1%", current );
 
           // slog( "                                 %1% unblocking blocking on %2%", current, p.get() );
@@ -805,23 +961,18 @@ namespace fc {
             iter = &(*iter)->next_blocked;
           }
 
-          bool task_removed_from_sleep_pqueue = false;
-          for (auto sleep_iter = sleep_pqueue.begin(); sleep_iter != sleep_pqueue.end();)
+          std::vector<fc::context*> canceled_sleepers;
+          for (fc::context* sleeping_context : sleep_pqueue)
+            if (sleeping_context->canceled)
+              canceled_sleepers.push_back(sleeping_context);
+          for (fc::context* canceled_context : canceled_sleepers)
           {
-            if ((*sleep_iter)->canceled)
-            {
-              bool already_on_ready_list = std::find(ready_heap.begin(), ready_heap.end(), 
-                                                     *sleep_iter) != ready_heap.end();
-              if (!already_on_ready_list)
-                add_context_to_ready_list(*sleep_iter);
-              sleep_iter = sleep_pqueue.erase(sleep_iter);
-              task_removed_from_sleep_pqueue = true;
-            }
-            else
-              ++sleep_iter;
+            bool already_on_ready_list = std::find(ready_heap.begin(), ready_heap.end(), 
+                                                   canceled_context) != ready_heap.end();
+            if (!already_on_ready_list)
+              add_context_to_ready_list(canceled_context);
+            sleep_pqueue.erase(canceled_context);
           }
-          if (task_removed_from_sleep_pqueue)
-            std::make_heap(sleep_pqueue.begin(), sleep_pqueue.end(), sleep_priority_less());
         }
     };
 } // namespace fc
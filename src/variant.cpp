@@ -18,6 +18,94 @@
 namespace fc
 {
 
+namespace {
+   /**
+    *  The string, array, object and blob behind a variant are each at most
+    *  node_size bytes.  Every thread keeps the nodes of destroyed variants in a
+    *  free list, so building and destroying variants in a loop (as API calls
+    *  and JSON conversions do) stops calling malloc once the list is warm.  A
+    *  string of up to 15 characters lives entirely inside its node thanks to
+    *  std::string's own small string buffer, so it needs no malloc at all.
+    *
+    *  Nodes may be freed on another thread than the one that allocated them,
+    *  they are plain operator new blocks and just join that thread's list.
+    */
+   const size_t node_size        = 32;
+   const size_t max_cached_nodes = 4096;
+
+   struct node_free_list
+   {
+      struct node { node* next; };
+      node*    head;
+      uint32_t count;
+      bool     closed; ///< the thread is exiting, free nodes right away
+   };
+   // trivially destructible, so it outlives the thread_local flush_guard below
+   thread_local node_free_list free_nodes = { nullptr, 0, false };
+
+   struct node_cache_flush_guard
+   {
+      ~node_cache_flush_guard()
+      {
+         free_nodes.closed = true;
+         while( free_nodes.head )
+         {
+            node_free_list::node* n = free_nodes.head;
+            free_nodes.head = n->next;
+            ::operator delete( n );
+         }
+         free_nodes.count = 0;
+      }
+   };
+   thread_local node_cache_flush_guard node_cache_guard;
+
+   void* allocate_node()
+   {
+      (void)&node_cache_guard; // make sure this thread flushes its list on exit
+      if( free_nodes.head )
+      {
+         node_free_list::node* n = free_nodes.head;
+         free_nodes.head = n->next;
+         --free_nodes.count;
+         return n;
+      }
+      return ::operator new( node_size );
+   }
+
+   void deallocate_node( void* p )
+   {
+      if( free_nodes.closed || free_nodes.count >= max_cached_nodes )
+         return ::operator delete( p );
+      node_free_list::node* n = static_cast<node_free_list::node*>( p );
+      n->next = free_nodes.head;
+      free_nodes.head = n;
+      ++free_nodes.count;
+   }
+
+   template<typename T, typename... Args>
+   T* new_node( Args&&... args )
+   {
+      static_assert( sizeof(T) <= node_size, "variant node too small" );
+      void* p = allocate_node();
+      try
+      {
+         return new (p) T( std::forward<Args>(args)... );
+      }
+      catch( ... )
+      {
+         deallocate_node( p );
+         throw;
+      }
+   }
+
+   template<typename T>
+   void delete_node( T* v )
+   {
+      v->~T();
+      deallocate_node( v );
+   }
+} // anonymous namespace
+
 /**
  *  The TypeID is stored in the 'last byte' of the variant.
  */
@@ -113,13 +201,13 @@ variant::variant( bool val, uint32_t max_depth )
 
 variant::variant( char* str, uint32_t max_depth )
 {
-   *reinterpret_cast<string**>(this)  = new string( str );
+   *reinterpret_cast<string**>(this)  = new_node<string>( str );
    set_variant_type( this, string_type );
 }
 
 variant::variant( const char* str, uint32_t max_depth )
 {
-   *reinterpret_cast<string**>(this)  = new string( str );
+   *reinterpret_cast<string**>(this)  = new_node<string>( str );
    set_variant_type( this, string_type );
 }
 
@@ -130,7 +218,7 @@ variant::variant( wchar_t* str, uint32_t max_depth )
    boost::scoped_array<char> buffer(new char[len]);
    for (unsigned i = 0; i < len; ++i)
       buffer[i] = (char)str[i];
-   *reinterpret_cast<string**>(this)  = new string(buffer.get(), len);
+   *reinterpret_cast<string**>(this)  = new_node<string>(buffer.get(), len);
    set_variant_type( this, string_type );
 }
 
@@ -141,35 +229,35 @@ variant::variant( const wchar_t* str, uint32_t max_depth )
    boost::scoped_array<char> buffer(new char[len]);
    for (unsigned i = 0; i < len; ++i)
       buffer[i] = (char)str[i];
-   *reinterpret_cast<string**>(this)  = new string(buffer.get(), len);
+   *reinterpret_cast<string**>(this)  = new_node<string>(buffer.get(), len);
    set_variant_type( this, string_type );
 }
 
 variant::variant( std::string val, uint32_t max_depth )
 {
-   *reinterpret_cast<string**>(this)  = new string( std::move(val) );
+   *reinterpret_cast<string**>(this)  = new_node<string>( std::move(val) );
    set_variant_type( this, string_type );
 }
 variant::variant( blob val, uint32_t max_depth )
 {
-   *reinterpret_cast<blob**>(this)  = new blob( std::move(val) );
+   *reinterpret_cast<blob**>(this)  = new_node<blob>( std::move(val) );
    set_variant_type( this, blob_type );
 }
 
 variant::variant( variant_object obj, uint32_t max_depth )
 {
-   *reinterpret_cast<variant_object**>(this) = new variant_object(std::move(obj));
+   *reinterpret_cast<variant_object**>(this) = new_node<variant_object>(std::move(obj));
    set_variant_type(this,  object_type );
 }
 variant::variant( mutable_variant_object obj, uint32_t max_depth )
 {
-   *reinterpret_cast<variant_object**>(this) = new variant_object(std::move(obj));
+   *reinterpret_cast<variant_object**>(this) = new_node<variant_object>(std::move(obj));
    set_variant_type(this,  object_type );
 }
 
 variant::variant( variants arr, uint32_t max_depth )
 {
-   *reinterpret_cast<variants**>(this)  = new variants(std::move(arr));
+   *reinterpret_cast<variants**>(this)  = new_node<variants>(std::move(arr));
    set_variant_type(this,  array_type );
 }
 
@@ -183,13 +271,16 @@ void variant::clear()
    switch( get_type() )
    {
      case object_type:
-        delete *reinterpret_cast<variant_object**>(this);
+        delete_node( *reinterpret_cast<variant_object**>(this) );
         break;
      case array_type:
-        delete *reinterpret_cast<variants**>(this);
+        delete_node( *reinterpret_cast<variants**>(this) );
         break;
      case string_type:
-        delete *reinterpret_cast<string**>(this);
+        delete_node( *reinterpret_cast<string**>(this) );
+        break;
+     case blob_type:
+        delete_node( *reinterpret_cast<blob**>(this) );
         break;
      default:
         break;
@@ -203,19 +294,24 @@ variant::variant( const variant& v, uint32_t max_depth )
    {
        case object_type:
           *reinterpret_cast<variant_object**>(this)  = 
-             new variant_object(**reinterpret_cast<const const_variant_object_ptr*>(&v));
+             new_node<variant_object>(**reinterpret_cast<const const_variant_object_ptr*>(&v));
           set_variant_type( this, object_type );
           return;
        case array_type:
           *reinterpret_cast<variants**>(this)  = 
-             new variants(**reinterpret_cast<const const_variants_ptr*>(&v));
+             new_node<variants>(**reinterpret_cast<const const_variants_ptr*>(&v));
           set_variant_type( this,  array_type );
           return;
        case string_type:
           *reinterpret_cast<string**>(this)  = 
-             new string(**reinterpret_cast<const const_string_ptr*>(&v) );
+             new_node<string>(**reinterpret_cast<const const_string_ptr*>(&v) );
           set_variant_type( this, string_type );
           return;
+       case blob_type:
+          *reinterpret_cast<blob**>(this)  =
+             new_node<blob>(**reinterpret_cast<const const_blob_ptr*>(&v) );
+          set_variant_type( this, blob_type );
+          return;
        default:
           memcpy( this, &v, sizeof(v) );
    }
@@ -251,14 +347,17 @@ variant& variant::operator=( const variant& v )
    {
       case object_type:
          *reinterpret_cast<variant_object**>(this)  = 
-            new variant_object((**reinterpret_cast<const const_variant_object_ptr*>(&v)));
+            new_node<variant_object>((**reinterpret_cast<const const_variant_object_ptr*>(&v)));
          break;
       case array_type:
          *reinterpret_cast<variants**>(this)  = 
-            new variants((**reinterpret_cast<const const_variants_ptr*>(&v)));
+            new_node<variants>((**reinterpret_cast<const const_variants_ptr*>(&v)));
          break;
       case string_type:
-         *reinterpret_cast<string**>(this)  = new string((**reinterpret_cast<const const_string_ptr*>(&v)) );
+         *reinterpret_cast<string**>(this)  = new_node<string>((**reinterpret_cast<const const_string_ptr*>(&v)) );
+         break;
+      case blob_type:
+         *reinterpret_cast<blob**>(this)  = new_node<blob>((**reinterpret_cast<const const_blob_ptr*>(&v)) );
          break;
 
       default:
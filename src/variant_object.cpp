@@ -1,10 +1,132 @@
 #include <fc/variant_object.hpp>
 #include <fc/exception/exception.hpp>
 #include <assert.h>
+#include <string.h>
 
 
 namespace fc
 {
+   namespace detail
+   {
+      /**
+       *  An open addressing hash table from the keys of the entries of an object
+       *  to their positions.  Only the first of duplicate keys is indexed, that
+       *  is the one a linear search finds.
+       */
+      class variant_object_index
+      {
+         public:
+            /** objects with fewer entries are searched linearly */
+            static const size_t min_entries = 16;
+
+            explicit variant_object_index( const std::vector<variant_object::entry>& entries )
+            {
+               size_t capacity = 32;
+               while( capacity < entries.size() * 2 )
+                  capacity *= 2;
+               _slots.resize( capacity );
+               for( size_t pos = 0; pos < entries.size(); ++pos )
+                  add( entries, pos );
+            }
+
+            /** Indexes entries[pos], entries before it must be indexed already */
+            void add( const std::vector<variant_object::entry>& entries, size_t pos )
+            {
+               if( (_count + 1) * 2 > _slots.size() )
+                  grow();
+               const string& key = entries[pos].key();
+               const uint32_t h = hash( key.data(), key.size() );
+               for( size_t i = h & (_slots.size() - 1); ; i = (i + 1) & (_slots.size() - 1) )
+               {
+                  if( _slots[i].pos == 0 )
+                  {
+                     _slots[i] = slot{ h, uint32_t(pos + 1) };
+                     ++_count;
+                     return;
+                  }
+                  if( _slots[i].hash == h && entries[_slots[i].pos - 1].key() == key )
+                     return;
+               }
+            }
+
+            /** @return the position of the entry with @p key, or entries.size() */
+            size_t find( const std::vector<variant_object::entry>& entries, const char* key )const
+            {
+               const size_t size = strlen( key );
+               const uint32_t h = hash( key, size );
+               for( size_t i = h & (_slots.size() - 1); _slots[i].pos != 0; i = (i + 1) & (_slots.size() - 1) )
+               {
+                  if( _slots[i].hash != h )
+                     continue;
+                  const string& k = entries[_slots[i].pos - 1].key();
+                  if( k.size() == size && memcmp( k.data(), key, size ) == 0 )
+                     return _slots[i].pos - 1;
+               }
+               return entries.size();
+            }
+
+         private:
+            struct slot
+            {
+               uint32_t hash;
+               uint32_t pos;  ///< position + 1, 0 marks a free slot
+            };
+
+            /** FNV-1a */
+            static uint32_t hash( const char* key, size_t size )
+            {
+               uint32_t h = 2166136261u;
+               for( size_t i = 0; i < size; ++i )
+                  h = ( h ^ uint8_t(key[i]) ) * 16777619u;
+               return h;
+            }
+
+            void grow()
+            {
+               std::vector<slot> old( _slots.size() * 2 );
+               old.swap( _slots );
+               for( const slot& s : old )
+               {
+                  if( s.pos == 0 )
+                     continue;
+                  size_t i = s.hash & (_slots.size() - 1);
+                  while( _slots[i].pos != 0 )
+                     i = (i + 1) & (_slots.size() - 1);
+                  _slots[i] = s;
+               }
+            }
+
+            std::vector<slot> _slots;
+            size_t            _count = 0;
+      };
+   }
+
+   namespace
+   {
+      /** @return the position of the entry with @p key, or entries.size() */
+      size_t find_position( const std::vector<variant_object::entry>& entries,
+                            std::shared_ptr<detail::variant_object_index>& index, const char* key )
+      {
+         if( entries.size() >= detail::variant_object_index::min_entries )
+         {
+            // find() is const, other threads may be searching the same object
+            auto current = std::atomic_load( &index );
+            if( !current )
+            {
+               current = std::make_shared<detail::variant_object_index>( entries );
+               std::atomic_store( &index, current );
+            }
+            return current->find( entries, key );
+         }
+         for( size_t pos = 0; pos < entries.size(); ++pos )
+         {
+            if( entries[pos].key() == key )
+               return pos;
+         }
+         return entries.size();
+      }
+   }
+
    // ---------------------------------------------------------------
    // entry
 
@@ -68,14 +190,7 @@ namespace fc
 
    variant_object::iterator variant_object::find( const char* key )const
    {
-      for( auto itr = begin(); itr != end(); ++itr )
-      {
-         if( itr->key() == key )
-         {
-            return itr;
-         }
-      }
-      return end();
+      return begin() + find_position( *_key_value, _index, key );
    }
 
    const variant& variant_object::operator[]( const string& key )const
@@ -107,25 +222,25 @@ namespace fc
    }
 
    variant_object::variant_object( const variant_object& obj )
-   :_key_value( obj._key_value )
+   :_key_value( obj._key_value ),_index( std::atomic_load( &obj._index ) )
    {
       assert( _key_value != nullptr );
    }
 
    variant_object::variant_object( variant_object&& obj)
-   : _key_value( std::move(obj._key_value) )
+   : _key_value( std::move(obj._key_value) ),_index( std::move(obj._index) )
    {
       obj._key_value = std::make_shared<std::vector<entry>>();
       assert( _key_value != nullptr );
    }
 
    variant_object::variant_object( const mutable_variant_object& obj )
-      : _key_value(std::make_shared<std::vector<entry>>(*obj._key_value))
+      : _key_value(std::make_shared<std::vector<entry>>(*obj._key_value)),_index( std::atomic_load( &obj._index ) )
    {
    }
 
    variant_object::variant_object( mutable_variant_object&& obj )
-   : _key_value(std::move(obj._key_value))
+   : _key_value(std::move(obj._key_value)),_index( std::move(obj._index) )
    {
       assert( _key_value != nullptr );
    }
@@ -135,6 +250,7 @@ namespace fc
       if (this != &obj)
       {
          std::swap(_key_value, obj._key_value );
+         std::swap(_index, obj._index );
          assert( _key_value != nullptr );
       }
       return *this;
@@ -145,6 +261,7 @@ namespace fc
       if (this != &obj)
       {
          _key_value = obj._key_value;
+         _index = std::atomic_load( &obj._index );
       }
       return *this;
    }
@@ -152,13 +269,16 @@ namespace fc
    variant_object& variant_object::operator=( mutable_variant_object&& obj )
    {
       _key_value = std::move(obj._key_value);
+      _index = std::move(obj._index);
       obj._key_value.reset( new std::vector<entry>() );
       return *this;
    }
 
    variant_object& variant_object::operator=( const mutable_variant_object& obj )
    {
-      *_key_value = *obj._key_value;
+      // the entries may be shared with other objects, which must not change
+      _key_value = std::make_shared<std::vector<entry>>(*obj._key_value);
+      _index = std::atomic_load( &obj._index );
       return *this;
    }
 
@@ -202,14 +322,7 @@ namespace fc
 
    mutable_variant_object::iterator mutable_variant_object::find( const char* key )const
    {
-      for( auto itr = begin(); itr != end(); ++itr )
-      {
-         if( itr->key() == key )
-         {
-            return itr;
-         }
-      }
-      return end();
+      return _key_value->begin() + find_position( *_key_value, _index, key );
    }
 
    mutable_variant_object::iterator mutable_variant_object::find( const string& key )
@@ -219,14 +332,7 @@ namespace fc
 
    mutable_variant_object::iterator mutable_variant_object::find( const char* key )
    {
-      for( auto itr = begin(); itr != end(); ++itr )
-      {
-         if( itr->key() == key )
-         {
-            return itr;
-         }
-      }
-      return end();
+      return _key_value->begin() + find_position( *_key_value, _index, key );
    }
 
    const variant& mutable_variant_object::operator[]( const string& key )const
@@ -250,6 +356,7 @@ namespace fc
       auto itr = find( key );
       if( itr != end() ) return itr->value();
       _key_value->emplace_back(entry(key, variant()));
+      index_appended();
       return _key_value->back().value();
    }
 
@@ -270,23 +377,24 @@ namespace fc
    }
 
    mutable_variant_object::mutable_variant_object( const variant_object& obj )
-      : _key_value( new std::vector<entry>(*obj._key_value) )
+      : _key_value( new std::vector<entry>(*obj._key_value) ),_index( std::atomic_load( &obj._index ) )
    {
    }
 
    mutable_variant_object::mutable_variant_object( const mutable_variant_object& obj )
-      : _key_value( new std::vector<entry>(*obj._key_value) )
+      : _key_value( new std::vector<entry>(*obj._key_value) ),_index( std::atomic_load( &obj._index ) )
    {
    }
 
    mutable_variant_object::mutable_variant_object( mutable_variant_object&& obj )
-      : _key_value(std::move(obj._key_value))
+      : _key_value(std::move(obj._key_value)),_index(std::move(obj._index))
    {
    }
 
    mutable_variant_object& mutable_variant_object::operator=( const variant_object& obj )
    {
       *_key_value = *obj._key_value;
+      _index = std::atomic_load( &obj._index );
       return *this;
    }
 
@@ -295,6 +403,7 @@ namespace fc
       if (this != &obj)
       {
          _key_value = std::move(obj._key_value);
+         _index = std::move(obj._index);
       }
       return *this;
    }
@@ -304,6 +413,7 @@ namespace fc
       if (this != &obj)
       {
          *_key_value = *obj._key_value;
+         _index = std::atomic_load( &obj._index );
       }
       return *this;
    }
@@ -320,6 +430,7 @@ namespace fc
          if( itr->key() == key )
          {
             _key_value->erase(itr);
+            _index.reset();
             return;
          }
       }
@@ -336,6 +447,7 @@ namespace fc
       else
       {
          _key_value->push_back( entry( std::move(key), std::move(var) ) );
+         index_appended();
       }
       return *this;
    }
@@ -346,9 +458,21 @@ namespace fc
    mutable_variant_object& mutable_variant_object::operator()( string key, variant var, uint32_t max_depth )
    {
       _key_value->push_back( entry( std::move(key), std::move(var) ) );
+      index_appended();
       return *this;
    }
 
+   /** Adds the last entry to the index, if there is one yet */
+   void mutable_variant_object::index_appended()
+   {
+      if( !_index )
+         return;
+      // variant_objects copied from this one may be searching the index
+      if( _index.use_count() > 1 )
+         _index = std::make_shared<detail::variant_object_index>( *_index );
+      _index->add( *_key_value, _key_value->size() - 1 );
+   }
+
    mutable_variant_object& mutable_variant_object::operator()( const variant_object& vo )
    {
       for( const variant_object::entry& e : vo )
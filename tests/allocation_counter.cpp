@@ -0,0 +1,94 @@
+#include "allocation_counter.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+   thread_local uint32_t thread_counters = 0;
+   thread_local uint64_t thread_allocations = 0;
+
+   std::atomic<uint32_t> process_counters( 0 );
+   std::atomic<uint64_t> process_allocations( 0 );
+
+   inline void count_allocation()
+   {
+      if( thread_counters )
+         ++thread_allocations;
+      if( process_counters.load( std::memory_order_relaxed ) )
+         process_allocations.fetch_add( 1, std::memory_order_relaxed );
+   }
+}
+
+namespace fc { namespace test {
+
+   allocation_counter::allocation_counter( scope_type scope )
+   :_scope(scope)
+   {
+      if( _scope == this_thread )
+      {
+         ++thread_counters;
+         _start = thread_allocations;
+      }
+      else
+      {
+         process_counters.fetch_add( 1 );
+         _start = process_allocations.load();
+      }
+   }
+
+   allocation_counter::~allocation_counter()
+   {
+      if( _scope == this_thread )
+         --thread_counters;
+      else
+         process_counters.fetch_sub( 1 );
+   }
+
+   uint64_t allocation_counter::count()const
+   {
+      if( _scope == this_thread )
+         return thread_allocations - _start;
+      return process_allocations.load() - _start;
+   }
+
+} } // fc::test
+
+void* operator new( std::size_t size )
+{
+   count_allocation();
+   if( void* p = malloc( size ? size : 1 ) )
+      return p;
+   throw std::bad_alloc();
+}
+
+void operator delete( void* p ) noexcept
+{
+   free( p );
+}
+
+void operator delete( void* p, std::size_t ) noexcept
+{
+   free( p );
+}
+
+#ifdef __cpp_aligned_new
+void* operator new( std::size_t size, std::align_val_t alignment )
+{
+   count_allocation();
+   const std::size_t align = static_cast<std::size_t>( alignment );
+   if( void* p = aligned_alloc( align, ( ( size ? size : 1 ) + align - 1 ) / align * align ) )
+      return p;
+   throw std::bad_alloc();
+}
+
+void operator delete( void* p, std::align_val_t ) noexcept
+{
+   free( p );
+}
+
+void operator delete( void* p, std::size_t, std::align_val_t ) noexcept
+{
+   free( p );
+}
+#endif
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+namespace fc { namespace test {
+
+   /**
+    *  Counts the calls to the global operator new made while it is alive, for
+    *  tests that measure the allocations saved by an optimization.  The counting
+    *  operator new is defined in allocation_counter.cpp; it only touches shared
+    *  state while an all_threads counter exists.
+    */
+   class allocation_counter
+   {
+      public:
+         enum scope_type
+         {
+            this_thread, ///< only allocations made by the constructing thread
+            all_threads  ///< allocations made by any thread, e.g. by the asio threads
+         };
+
+         explicit allocation_counter( scope_type scope = this_thread );
+         ~allocation_counter();
+
+         /** @return the number of allocations counted so far */
+         uint64_t count()const;
+
+      private:
+         allocation_counter( const allocation_counter& ) = delete;
+         allocation_counter& operator=( const allocation_counter& ) = delete;
+
+         scope_type _scope;
+         uint64_t   _start;
+   };
+
+} } // fc::test
@@ -42,6 +42,13 @@ public:
     }
 };
 
+class waiting_api
+{
+   public:
+      int32_t wait_ms( int32_t ms ) { fc::usleep( fc::milliseconds( ms ) ); return ms; }
+      int32_t echo( int32_t i ) { return i; }
+};
+
 class some_calculator
 {
    public:
@@ -57,6 +64,7 @@ class some_calculator
 FC_API( fc::test::calculator, (add)(sub)(on_result)(on_result2) )
 FC_API( fc::test::login_api, (get_calc)(test) );
 FC_API( fc::test::optionals_api, (foo)(bar) );
+FC_API( fc::test::waiting_api, (wait_ms)(echo) );
 
 using namespace fc::http;
 using namespace fc::rpc;
@@ -176,4 +184,149 @@ BOOST_AUTO_TEST_CASE(optionals_test) {
    } FC_LOG_AND_RETHROW()
 }
 
+/** A raw websocket client connection that waits for the reply to each message it sends */
+class raw_rpc_client
+{
+   public:
+      explicit raw_rpc_client( uint16_t port )
+      {
+         _client = std::make_shared<fc::http::websocket_client>();
+         _con = _client->connect( "ws://localhost:" + std::to_string( port ) );
+         _con->on_message_handler( [this]( const std::string& s ){
+            if( _reply )
+               _reply->set_value( s );
+         } );
+      }
+      ~raw_rpc_client()
+      {
+         _client->synchronous_close();
+      }
+
+      std::string call( const std::string& message )
+      {
+         _reply = fc::promise<std::string>::create();
+         _con->send_message( message );
+         std::string reply = _reply->wait( fc::seconds( 10 ) );
+         _reply.reset();
+         return reply;
+      }
+
+      void send( const std::string& message )
+      {
+         _con->send_message( message );
+      }
+
+   private:
+      std::shared_ptr<fc::http::websocket_client> _client;
+      websocket_connection_ptr                    _con;
+      fc::promise<std::string>::ptr               _reply;
+};
+
+static std::string echo_request( uint32_t id, bool with_id = true )
+{
+   return std::string( "{\"jsonrpc\":\"2.0\"," ) + ( with_id ? "\"id\":" + std::to_string( id ) + "," : "" )
+          + "\"method\":\"call\",\"params\":[0,\"echo\",[" + std::to_string( id ) + "]]}";
+}
+
+BOOST_AUTO_TEST_CASE(batch_test) {
+   try {
+      auto waiting = std::make_shared<fc::test::waiting_api>();
+      auto server = std::make_shared<fc::http::websocket_server>("");
+      server->on_connection([&]( const websocket_connection_ptr& c ){
+               auto wsc = std::make_shared<websocket_api_connection>(c, MAX_DEPTH);
+               wsc->register_api(fc::api<fc::test::waiting_api>(waiting));
+               wsc->set_batch_read_only_filter( []( const fc::rpc::request& r ) {
+                  return r.params.size() > 1 && r.params[1] == "wait_ms";
+               } );
+               c->set_session_data( wsc );
+          });
+      server->listen( 0 );
+      auto listen_port = server->get_listening_port();
+      server->start_accept();
+
+      {
+         raw_rpc_client client( listen_port );
+
+         // replies in request order, none for notifications, errors for invalid elements
+         fc::variant replies = fc::json::from_string( client.call( "[" + echo_request( 1 ) + ","
+               + echo_request( 2, false ) + ",5,"
+               + "{\"jsonrpc\":\"2.0\",\"id\":\"x\",\"method\":\"call\",\"params\":[0,\"missing\",[]]},"
+               + echo_request( 3 ) + "]" ) );
+         BOOST_REQUIRE_EQUAL( 4u, replies.get_array().size() );
+         BOOST_CHECK_EQUAL( 1, replies.get_array()[0]["id"].as_int64() );
+         BOOST_CHECK_EQUAL( 1, replies.get_array()[0]["result"].as_int64() );
+         BOOST_CHECK( replies.get_array()[1]["id"].is_null() );
+         BOOST_CHECK_EQUAL( -32600, replies.get_array()[1]["error"]["code"].as_int64() );
+         BOOST_CHECK_EQUAL( "x", replies.get_array()[2]["id"].as_string() );
+         BOOST_CHECK( replies.get_array()[2].get_object().contains( "error" ) );
+         BOOST_CHECK_EQUAL( 3, replies.get_array()[3]["result"].as_int64() );
+
+         fc::variant empty = fc::json::from_string( client.call( "[]" ) );
+         BOOST_CHECK_EQUAL( -32600, empty["error"]["code"].as_int64() );
+
+         // a batch of notifications has no reply, the next message is answered normally
+         client.send( "[" + echo_request( 4, false ) + "," + echo_request( 5, false ) + "]" );
+         BOOST_CHECK_EQUAL( "{\"id\":6,\"jsonrpc\":\"2.0\",\"result\":6}", client.call( echo_request( 6 ) ) );
+
+         // read-only calls run concurrently, the others wait for them
+         fc::time_point start = fc::time_point::now();
+         replies = fc::json::from_string( client.call( "[{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"call\",\"params\":[0,\"wait_ms\",[200]]},"
+               "{\"jsonrpc\":\"2.0\",\"id\":2,\"method\":\"call\",\"params\":[0,\"wait_ms\",[200]]},"
+               "{\"jsonrpc\":\"2.0\",\"id\":3,\"method\":\"call\",\"params\":[0,\"wait_ms\",[200]]}," + echo_request( 4 ) + "]" ) );
+         fc::microseconds elapsed = fc::time_point::now() - start;
+         BOOST_REQUIRE_EQUAL( 4u, replies.get_array().size() );
+         for( int64_t i = 0; i < 4; ++i )
+            BOOST_CHECK_EQUAL( i + 1, replies.get_array()[i]["id"].as_int64() );
+         BOOST_CHECK_LT( elapsed.count(), 500000 );
+      }
+
+      server->stop_listening();
+      server->close();
+      fc::usleep(fc::milliseconds(50));
+      server.reset();
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE(batch_benchmark) {
+   try {
+      auto waiting = std::make_shared<fc::test::waiting_api>();
+      auto server = std::make_shared<fc::http::websocket_server>("");
+      server->on_connection([&]( const websocket_connection_ptr& c ){
+               auto wsc = std::make_shared<websocket_api_connection>(c, MAX_DEPTH);
+               wsc->register_api(fc::api<fc::test::waiting_api>(waiting));
+               c->set_session_data( wsc );
+          });
+      server->listen( 0 );
+      auto listen_port = server->get_listening_port();
+      server->start_accept();
+
+      {
+         raw_rpc_client client( listen_port );
+         const uint32_t calls = 200;
+
+         fc::time_point start = fc::time_point::now();
+         for( uint32_t i = 0; i < calls; ++i )
+            BOOST_REQUIRE_EQUAL( i, fc::json::from_string( client.call( echo_request( i ) ) )["result"].as_uint64() );
+         fc::time_point singles_done = fc::time_point::now();
+
+         std::string batch = "[";
+         for( uint32_t i = 0; i < calls; ++i )
+            batch += ( i ? "," : "" ) + echo_request( i );
+         batch += "]";
+         fc::variant replies = fc::json::from_string( client.call( batch ) );
+         fc::time_point batch_done = fc::time_point::now();
+
+         BOOST_REQUIRE_EQUAL( calls, replies.get_array().size() );
+         BOOST_CHECK_EQUAL( calls - 1, replies.get_array().back()["result"].as_uint64() );
+         BOOST_TEST_MESSAGE( calls << " calls over loopback: one message each " << ( singles_done - start ).count()
+                             << " us, one batch " << ( batch_done - singles_done ).count() << " us" );
+      }
+
+      server->stop_listening();
+      server->close();
+      fc::usleep(fc::milliseconds(50));
+      server.reset();
+   } FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_SUITE_END()
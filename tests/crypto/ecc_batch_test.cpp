@@ -0,0 +1,90 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <fc/crypto/elliptic.hpp>
+#include <fc/exception/exception.hpp>
+#include <fc/thread/parallel.hpp>
+#include <fc/time.hpp>
+
+namespace {
+   struct signed_digests
+   {
+      explicit signed_digests( size_t count )
+      {
+         for( size_t i = 0; i < count; ++i )
+         {
+            fc::ecc::private_key key = fc::ecc::private_key::regenerate( fc::sha256::hash( "key" + std::to_string( i % 10 ) ) );
+            digests.push_back( fc::sha256::hash( "message" + std::to_string( i ) ) );
+            signatures.push_back( key.sign_compact( digests.back() ) );
+            keys.push_back( key.get_public_key() );
+         }
+      }
+
+      std::vector<fc::sha256>                    digests;
+      std::vector<fc::ecc::compact_signature>    signatures;
+      std::vector<fc::ecc::public_key>           keys;
+   };
+}
+
+BOOST_AUTO_TEST_SUITE(fc_crypto)
+
+BOOST_AUTO_TEST_CASE(recover_batch_test)
+{
+   for( size_t count : { 0, 5, 100 } )
+   {
+      signed_digests data( count );
+      if( count > 0 )
+      {
+         data.signatures[0][0] = 26;                  // bad recovery id
+         data.signatures[count - 1][1] |= 0x80;       // not canonical
+      }
+
+      std::vector<fc::ecc::public_key> recovered = fc::ecc::recover_batch( data.signatures, data.digests );
+      BOOST_REQUIRE_EQUAL( count, recovered.size() );
+      for( size_t i = 0; i < count; ++i )
+      {
+         if( i == 0 || i == count - 1 )
+         {
+            BOOST_CHECK( !recovered[i].valid() );
+            BOOST_CHECK_THROW( fc::ecc::public_key( data.signatures[i], data.digests[i] ), fc::exception );
+         }
+         else
+         {
+            BOOST_REQUIRE( recovered[i].valid() );
+            BOOST_CHECK( data.keys[i] == recovered[i] );
+         }
+      }
+   }
+
+   signed_digests data( 20 );
+   data.digests[3] = fc::sha256::hash( std::string( "another message" ) );
+   std::vector<fc::ecc::public_key> recovered = fc::ecc::recover_batch( data.signatures, data.digests );
+   BOOST_CHECK( data.keys[3] != recovered[3] );
+   BOOST_CHECK( fc::ecc::public_key( data.signatures[3], data.digests[3] ) == recovered[3] );
+   BOOST_CHECK( data.keys[4] == recovered[4] );
+
+   data.digests.pop_back();
+   BOOST_CHECK_THROW( fc::ecc::recover_batch( data.signatures, data.digests ), fc::assert_exception );
+}
+
+BOOST_AUTO_TEST_CASE(recover_batch_benchmark)
+{
+   const size_t count = 2000;
+   signed_digests data( count );
+
+   fc::time_point start = fc::time_point::now();
+   for( size_t i = 0; i < count; ++i )
+      BOOST_CHECK( fc::ecc::public_key( data.signatures[i], data.digests[i] ) == data.keys[i] );
+   fc::time_point serial = fc::time_point::now();
+   std::vector<fc::ecc::public_key> recovered = fc::ecc::recover_batch( data.signatures, data.digests );
+   fc::time_point batch = fc::time_point::now();
+
+   BOOST_CHECK( recovered == data.keys );
+   BOOST_TEST_MESSAGE( "recovered signatures per second on " << boost::thread::hardware_concurrency() << " cores: "
+                       << count * 1000000 / std::max<int64_t>( 1, ( serial - start ).count() ) << " one at a time, "
+                       << count * 1000000 / std::max<int64_t>( 1, ( batch - serial ).count() )
+                       << " with recover_batch on " << fc::detail::get_worker_pool().num_threads()
+                       << " worker threads" );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -9,8 +9,81 @@
 #include <fc/io/iostream.hpp>
 #include <fc/io/json.hpp>
 #include <fc/io/sstream.hpp>
+#include <fc/reflect/variant.hpp>
+#include <fc/time.hpp>
 
+#include <cstdlib>
 #include <fstream>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <sys/stat.h>
+#endif
+
+/** @return the peak resident set size of the process in MB, 0 where it is unknown */
+static uint64_t peak_rss_mb()
+{
+#ifndef _WIN32
+   struct rusage usage;
+   if( getrusage( RUSAGE_SELF, &usage ) == 0 )
+      return usage.ru_maxrss / 1024;
+#endif
+   return 0;
+}
+
+namespace fc { namespace test {
+
+   enum json_color { red, green };
+
+   struct json_point
+   {
+      int32_t x = 0;
+      int32_t y = 0;
+   };
+
+   /** Reflected, but converted by its own to_variant */
+   struct json_hex_id
+   {
+      uint32_t value = 0;
+   };
+   void to_variant( const json_hex_id& id, variant& v, uint32_t max_depth )
+   {
+      v = "0x" + fc::to_hex( reinterpret_cast<const char*>( &id.value ), sizeof(id.value) );
+   }
+
+   struct json_shape
+   {
+      std::string                name;
+      json_color                 color = red;
+      bool                       closed = false;
+      uint8_t                    layer = 0;
+      int64_t                    area = 0;
+      uint64_t                   owner = 0;
+      double                     scale = 1;
+      std::vector<json_point>    points;
+      std::vector<char>          tag;
+      optional<json_point>       center;
+      optional<std::string>      note;
+      json_hex_id                id;
+      variant                    extra;
+      fc::time_point_sec         created;
+      std::vector<std::vector<uint16_t>> grid;
+   };
+
+   struct json_derived_shape : json_shape
+   {
+      std::vector<json_shape> children;
+   };
+
+} } // fc::test
+
+FC_REFLECT_ENUM( fc::test::json_color, (red)(green) )
+FC_REFLECT( fc::test::json_point, (x)(y) )
+FC_REFLECT( fc::test::json_hex_id, (value) )
+FC_REFLECT( fc::test::json_shape,
+            (name)(color)(closed)(layer)(area)(owner)(scale)(points)(tag)(center)(note)(id)(extra)(created)(grid) )
+FC_REFLECT_DERIVED( fc::test::json_derived_shape, (fc::test::json_shape), (children) )
 
 BOOST_AUTO_TEST_SUITE(json_tests)
 
@@ -373,4 +446,448 @@ BOOST_AUTO_TEST_CASE(rethrow_test)
    BOOST_CHECK_THROW( test_cr(), fc::unknown_host_exception );
 }
 
+static fc::variant from_stringstream( const std::string& str, fc::json::parse_type ptype )
+{
+   fc::istream_ptr in( new fc::stringstream( str ) );
+   fc::buffered_istream bin( in );
+   return fc::json::from_stream( bin, ptype );
+}
+
+BOOST_AUTO_TEST_CASE(buffer_parser_matches_stream_parser)
+{
+   const std::vector<std::string> inputs = {
+      "{\"a\":1,\"b\":[true,false,null],\"c\":\"x\"}",
+      "[\"tab\\there\",\"new\\nline\",\"back\\\\slash\",\"quote\\\"d\",\"\\u0041\",\"\\/\"]",
+      "\"a string that is longer than one vector register, with an \\\" escape at the end\\\\\"",
+      "  [ 1 , -2 , 3.5 , -.5 , 18446744073709551615 , -9223372036854775807 ]  ",
+      "{ \"nested\" : { \"deeper\" : [ { } , [ ] , \"\" ] } }",
+      "[nullx, tru, falsey, unquoted-token_1:2/3]",
+      "12abc",
+      "\"unterminated",
+      "[1,2",
+      "{\"a\" 1}",
+      std::string( "[\"nul\\0\",\"" ) + '\0' + "\"]",
+      std::string( "\"eot" ) + '\x04' + "\"",
+      "\"" + std::string( 100, 'x' ) + "\\n" + std::string( 40, 'y' ) + "\"",
+      "[1] trailing",
+      ""
+   };
+   for( const auto& ptype : { fc::json::legacy_parser, fc::json::broken_nul_parser } )
+      for( const auto& input : inputs )
+      {
+         fc::optional<fc::variant> from_buffer, from_stream;
+         std::string buffer_error, stream_error;
+         try { from_buffer = fc::json::from_string( input, ptype ); }
+         catch( const fc::exception& e ) { buffer_error = e.name(); }
+         try { from_stream = from_stringstream( input, ptype ); }
+         catch( const fc::exception& e ) { stream_error = e.name(); }
+         BOOST_CHECK_MESSAGE( buffer_error == stream_error,
+                              input << ": " << buffer_error << " != " << stream_error );
+         if( from_buffer.valid() && from_stream.valid() )
+            BOOST_CHECK_MESSAGE( fc::json::to_string( *from_buffer ) == fc::json::to_string( *from_stream ), input );
+      }
+
+   BOOST_CHECK( fc::json::is_valid( "[1,2]" ) );
+   BOOST_CHECK( !fc::json::is_valid( "[1,2] x" ) );
+   BOOST_CHECK_EQUAL( 3u, fc::json::variants_from_string( "1 \"two\" [3]" ).size() );
+}
+
+BOOST_AUTO_TEST_CASE(parse_throughput)
+{
+   std::string json = "[";
+   for( uint32_t i = 0; i < 8000; ++i )
+   {
+      if( i ) json += ',';
+      json += "{\"id\":\"1.11." + std::to_string( 1000000 + i ) + "\",\"block_num\":" + std::to_string( 3000000 + i )
+            + ",\"amount\":-" + std::to_string( i * 12345 ) + ",\"fee\":0.25,\"virtual\":false,"
+            + "\"memo\":\"transfer memo number " + std::to_string( i ) + " with a \\\"quoted\\\" part\","
+            + "\"signatures\":[\"1f" + std::string( 128, 'a' + i % 6 ) + "\"],\"extensions\":[]}";
+   }
+   json += "]";
+
+   fc::time_point start = fc::time_point::now();
+   fc::variant from_buffer = fc::json::from_string( json );
+   fc::time_point buffered = fc::time_point::now();
+   fc::variant from_stream = from_stringstream( json, fc::json::legacy_parser );
+   fc::time_point streamed = fc::time_point::now();
+
+   BOOST_CHECK_EQUAL( 8000u, from_buffer.get_array().size() );
+   BOOST_CHECK( fc::json::to_string( from_buffer ) == fc::json::to_string( from_stream ) );
+   auto mb_per_sec = [&json]( fc::microseconds t ) { return double( json.size() ) / std::max<int64_t>( t.count(), 1 ); };
+   BOOST_TEST_MESSAGE( "parsing " << json.size() << " bytes of JSON: from_string " << mb_per_sec( buffered - start )
+                       << " MB/s, from_stream " << mb_per_sec( streamed - buffered ) << " MB/s" );
+}
+
+BOOST_AUTO_TEST_CASE(writer_output_test)
+{
+   fc::mutable_variant_object obj;
+   obj( "null", fc::variant() )
+      ( "small", int64_t( -42 ) )
+      ( "min", std::numeric_limits<int64_t>::min() )
+      ( "big", uint64_t( 0x100000000ull ) )
+      ( "umax", std::numeric_limits<uint64_t>::max() )
+      ( "double", 0.5 )
+      ( "flag", true )
+      ( "text", std::string( "a \"quoted\" \\ path\b\f\n\r\t\x01\x1f\x7f \xc3\xa9 and some padding to fill a block" ) )
+      ( "list", fc::variants{ fc::variant( 1 ), fc::variant( "two" ), fc::variant( fc::variants() ) } )
+      ( "empty", fc::variant_object() );
+   fc::variant v( obj );
+
+   const std::string text = "\"a \\\"quoted\\\" \\\\ path\\b\\f\\n\\r\\t\\u0001\\u001f\x7f \xc3\xa9 and some padding to fill a block\"";
+   BOOST_CHECK_EQUAL( "{\"null\":null,\"small\":-42,\"min\":\"-9223372036854775808\",\"big\":\"4294967296\","
+                      "\"umax\":\"18446744073709551615\",\"double\":\"0.50000000000000000\",\"flag\":true,"
+                      "\"text\":" + text + ",\"list\":[1,\"two\",[]],\"empty\":{}}",
+                      fc::json::to_string( v ) );
+   BOOST_CHECK_EQUAL( "{\"null\":null,\"small\":-42,\"min\":-9223372036854775808,\"big\":4294967296,"
+                      "\"umax\":18446744073709551615,\"double\":0.50000000000000000,\"flag\":true,"
+                      "\"text\":" + text + ",\"list\":[1,\"two\",[]],\"empty\":{}}",
+                      fc::json::to_string( v, fc::json::legacy_generator ) );
+
+   fc::stringstream ss;
+   fc::json::to_stream( ss, v );
+   BOOST_CHECK_EQUAL( fc::json::to_string( v ), ss.str() );
+
+   // a large document reaches the stream in chunks instead of as one string
+   struct chunk_stream : public fc::ostream
+   {
+      size_t writesome( const char* buf, size_t len )override
+      {
+         text.append( buf, len );
+         largest = std::max( largest, len );
+         return len;
+      }
+      size_t writesome( const std::shared_ptr<const char>& buf, size_t len, size_t offset )override
+      {
+         return writesome( buf.get() + offset, len );
+      }
+      void close()override {}
+      void flush()override {}
+      std::string text;
+      size_t      largest = 0;
+   } chunks;
+   fc::variants large( 20000, fc::variant( std::string( 100, 'x' ) ) );
+   fc::json::to_stream( chunks, large );
+   BOOST_CHECK( fc::json::to_string( large ) == chunks.text );
+   BOOST_CHECK_LT( chunks.largest, fc::json::save_options().buffer_size + 1024 );
+
+   std::string buffer = "[";
+   fc::json::append_to_string( buffer, fc::variant( "x" ) );
+   buffer += ',';
+   fc::json::append_to_string( buffer, fc::variant( 7 ) );
+   BOOST_CHECK_EQUAL( "[\"x\",7", buffer );
+}
+
+BOOST_AUTO_TEST_CASE(pretty_output_test)
+{
+   fc::mutable_variant_object obj;
+   obj( "a", "x\ty" )( "b", 1 )( "c", fc::variants{ fc::variant( 1 ), fc::variant( 2 ) } )
+      ( "d", fc::variant_object() )( "e", fc::variants() );
+   // the whole document is indented, also after an escaped character
+   BOOST_CHECK_EQUAL( "{\n  \"a\": \"x\\ty\",\n  \"b\": 1,\n  \"c\": [\n    1,\n    2\n  ],\n  \"d\": {},\n  \"e\": []\n}",
+                      fc::json::to_pretty_string( fc::variant( obj ) ) );
+
+   fc::variants objects{ fc::variant( fc::mutable_variant_object( "a", 1 ) ),
+                         fc::variant( fc::mutable_variant_object( "b", fc::variants{ fc::variant( "s" ) } ) ) };
+   BOOST_CHECK_EQUAL( "[{\n    \"a\": 1\n  },{\n    \"b\": [\n      \"s\"\n    ]\n  }\n]",
+                      fc::json::to_pretty_string( fc::variant( objects ) ) );
+   BOOST_CHECK_EQUAL( "\"4294967296\"", fc::json::to_pretty_string( fc::variant( uint64_t( 0x100000000ull ) ) ) );
+}
+
+BOOST_AUTO_TEST_CASE(write_throughput)
+{
+   fc::variants list;
+   for( uint32_t i = 0; i < 8000; ++i )
+   {
+      fc::mutable_variant_object obj;
+      obj( "id", "1.11." + std::to_string( 1000000 + i ) )( "block_num", 3000000 + i )
+         ( "amount", -int64_t( i ) * 12345 )( "fee", 0.25 )( "virtual", false )
+         ( "memo", "transfer memo number " + std::to_string( i ) + " with a \"quoted\" part" )
+         ( "signatures", fc::variants{ fc::variant( "1f" + std::string( 128, 'a' + i % 6 ) ) } )
+         ( "extensions", fc::variants() );
+      list.emplace_back( obj );
+   }
+   fc::variant v( list );
+
+   fc::time_point start = fc::time_point::now();
+   std::string compact = fc::json::to_string( v );
+   fc::time_point written = fc::time_point::now();
+   std::string pretty = fc::json::to_pretty_string( v );
+   fc::time_point pretty_written = fc::time_point::now();
+
+   BOOST_CHECK_EQUAL( compact, fc::json::to_string( fc::json::from_string( compact ) ) );
+   BOOST_CHECK_EQUAL( compact, fc::json::to_string( fc::json::from_string( pretty ) ) );
+   auto mb_per_sec = []( size_t size, fc::microseconds t ) { return double( size ) / std::max<int64_t>( t.count(), 1 ); };
+   BOOST_TEST_MESSAGE( "writing " << compact.size() << " bytes of JSON: to_string " << mb_per_sec( compact.size(), written - start )
+                       << " MB/s, to_pretty_string " << mb_per_sec( pretty.size(), pretty_written - written ) << " MB/s" );
+}
+
+static fc::test::json_shape make_shape( uint32_t i )
+{
+   fc::test::json_shape shape;
+   shape.name = "shape \"" + std::to_string( i ) + "\"\n";
+   shape.color = i % 2 ? fc::test::green : fc::test::red;
+   shape.closed = i % 3 == 0;
+   shape.layer = uint8_t( i );
+   shape.area = -int64_t( i ) * 1000000000;
+   shape.owner = uint64_t( i ) << 33;
+   shape.scale = 0.125 * i;
+   for( uint32_t p = 0; p < 4; ++p )
+      shape.points.push_back( { int32_t( i + p ), -int32_t( p ) } );
+   shape.tag = { 'a', char( i ) };
+   if( i % 2 )
+      shape.center = fc::test::json_point{ 1, 2 };
+   else
+      shape.note = "even";
+   shape.id.value = i;
+   shape.extra = fc::mutable_variant_object( "i", i )( "list", fc::variants{ fc::variant( "x" ), fc::variant() } );
+   shape.created = fc::time_point_sec( 1500000000 + i );
+   shape.grid = { { 1, 2 }, {}, { uint16_t( i ) } };
+   return shape;
+}
+
+BOOST_AUTO_TEST_CASE(reflected_to_string_test)
+{
+   static_assert( fc::has_custom_to_variant<fc::test::json_hex_id>::value, "" );
+   static_assert( !fc::has_custom_to_variant<fc::test::json_shape>::value, "" );
+   static_assert( !fc::has_custom_to_variant<fc::test::json_point>::value, "" );
+
+   fc::test::json_derived_shape derived;
+   static_cast<fc::test::json_shape&>( derived ) = make_shape( 3 );
+   derived.children = { make_shape( 4 ), make_shape( 5 ) };
+
+   for( auto format : { fc::json::stringify_large_ints_and_doubles, fc::json::legacy_generator } )
+   {
+      BOOST_CHECK_EQUAL( fc::json::to_string( fc::variant( derived, 10 ), format, 10 ),
+                         fc::json::to_string( derived, format, 10 ) );
+      BOOST_CHECK_EQUAL( fc::json::to_pretty_string( fc::variant( derived, 10 ), format, 10 ),
+                         fc::json::to_pretty_string( derived, format, 10 ) );
+      BOOST_CHECK_EQUAL( fc::json::to_string( fc::variant( derived.children, 10 ), format, 10 ),
+                         fc::json::to_string( derived.children, format, 10 ) );
+   }
+   BOOST_CHECK_EQUAL( "{\"x\":1,\"y\":2}", fc::json::to_string( fc::test::json_point{ 1, 2 } ) );
+
+   // the direct path fails at the same depths as the variant path
+   for( uint32_t depth = 0; depth < 9; ++depth )
+   {
+      std::string expected;
+      try {
+         expected = fc::json::to_string( fc::variant( derived, depth ), fc::json::stringify_large_ints_and_doubles, depth );
+      } catch( const fc::assert_exception& ) {}
+      std::string direct;
+      try {
+         direct = fc::json::to_string( derived, fc::json::stringify_large_ints_and_doubles, depth );
+      } catch( const fc::assert_exception& ) {}
+      BOOST_CHECK_EQUAL( expected, direct );
+      BOOST_CHECK_EQUAL( depth >= 6, !direct.empty() );
+   }
+}
+
+BOOST_AUTO_TEST_CASE(reflected_to_string_throughput)
+{
+   std::vector<fc::test::json_shape> shapes;
+   for( uint32_t i = 0; i < 4000; ++i )
+      shapes.push_back( make_shape( i ) );
+
+   fc::time_point start = fc::time_point::now();
+   std::string direct = fc::json::to_string( shapes, fc::json::stringify_large_ints_and_doubles, 10 );
+   fc::time_point written = fc::time_point::now();
+   std::string via_variant = fc::json::to_string( fc::variant( shapes, 10 ), fc::json::stringify_large_ints_and_doubles, 10 );
+   fc::time_point converted = fc::time_point::now();
+
+   BOOST_CHECK_EQUAL( via_variant, direct );
+   BOOST_TEST_MESSAGE( "writing " << shapes.size() << " reflected objects: directly " << ( written - start ).count()
+                       << " us, through a variant " << ( converted - written ).count() << " us" );
+}
+
+BOOST_AUTO_TEST_CASE(load_large_file)
+{
+   fc::temp_directory dir;
+   const fc::path file = dir.path() / "large.json";
+   size_t size = 0;
+   {
+      std::ofstream out( file.generic_string(), std::ios::binary );
+      out << "[";
+      for( uint32_t i = 0; i < 200000; ++i )
+      {
+         std::string line = std::string( i ? "," : "" ) + "{\"id\":\"1.11." + std::to_string( i ) + "\",\"amount\":"
+                          + std::to_string( i * 12345 ) + ",\"memo\":\"" + std::string( 100, 'a' + i % 26 ) + "\"}";
+         out << line;
+         size += line.size();
+      }
+      out << "]";
+      size += 2;
+   }
+
+   const uint64_t rss_start = peak_rss_mb();
+   fc::time_point start = fc::time_point::now();
+   std::string contents;
+   fc::read_file_contents( file, contents );
+   fc::time_point read = fc::time_point::now();
+   const uint64_t rss_read = peak_rss_mb();
+   BOOST_CHECK_EQUAL( size, contents.size() );
+   contents = std::string();
+
+   fc::variant v = fc::json::from_file( file );
+   fc::time_point parsed = fc::time_point::now();
+   BOOST_CHECK_EQUAL( 200000u, v.get_array().size() );
+   BOOST_CHECK_EQUAL( "1.11.199999", v.get_array().back()["id"].as_string() );
+
+   BOOST_TEST_MESSAGE( "loading " << size / 1000000 << " MB of JSON: read_file_contents " << ( read - start ).count() / 1000
+                       << " ms, peak RSS +" << rss_read - rss_start << " MB; json::from_file "
+                       << ( parsed - read ).count() / 1000 << " ms, peak RSS +" << peak_rss_mb() - rss_read << " MB" );
+
+   std::string missing;
+   fc::read_file_contents( dir.path() / "missing.json", missing );
+   BOOST_CHECK( missing.empty() );
+   BOOST_CHECK_THROW( fc::json::from_file( dir.path() / "missing.json" ), fc::exception );
+   { std::ofstream empty( ( dir.path() / "empty.json" ).generic_string() ); }
+   fc::read_file_contents( dir.path() / "empty.json", missing );
+   BOOST_CHECK( missing.empty() );
+   BOOST_CHECK_THROW( fc::json::from_file( dir.path() / "empty.json" ), fc::exception );
+}
+
+#ifndef _WIN32
+BOOST_AUTO_TEST_CASE(read_unsized_file)
+{
+   // a FIFO reports no size and can't be mapped, so it has to be read as a stream
+   fc::temp_directory dir;
+   const fc::path fifo = dir.path() / "contents.fifo";
+   BOOST_REQUIRE_EQUAL( 0, mkfifo( fifo.string().c_str(), 0600 ) );
+   std::string expected = "[1";
+   for( int i = 0; i < 50000; ++i )
+      expected += ",1";
+   expected += "]";
+   auto write_fifo = [&fifo,&expected]() {
+      std::ofstream out( fifo.string(), std::ios::binary );
+      out << expected;
+   };
+
+   std::thread writer( write_fifo );
+   std::string contents;
+   fc::read_file_contents( fifo, contents );
+   writer.join();
+   BOOST_CHECK( contents == expected );
+
+   writer = std::thread( write_fifo );
+   fc::variant v = fc::json::from_file( fifo );
+   writer.join();
+   BOOST_CHECK_EQUAL( 50001u, v.get_array().size() );
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(save_to_file_test)
+{
+   fc::test::json_derived_shape derived;
+   static_cast<fc::test::json_shape&>( derived ) = make_shape( 3 );
+   derived.children = { make_shape( 4 ), make_shape( 5 ) };
+   const fc::variant v( derived, 10 );
+
+   fc::temp_directory dir;
+   const fc::path file = dir.path() / "saved.json";
+   std::string contents;
+   for( bool pretty : { false, true } )
+      for( size_t buffer_size : { size_t(1), size_t(100), size_t(1) << 20 } )
+         for( bool atomic_replace : { false, true } )
+         {
+            fc::json::save_options opts;
+            opts.pretty = pretty;
+            opts.max_depth = 10;
+            opts.buffer_size = buffer_size;
+            opts.atomic_replace = atomic_replace;
+            opts.sync = atomic_replace ? fc::json::sync_file_and_directory : fc::json::sync_file;
+            const std::string expected = pretty ? fc::json::to_pretty_string( v, opts.format, 10 )
+                                                : fc::json::to_string( v, opts.format, 10 );
+
+            fc::json::save_to_file( v, file, opts );
+            fc::read_file_contents( file, contents );
+            BOOST_CHECK_EQUAL( expected, contents );
+
+            fc::json::save_to_file( derived, file, opts );
+            fc::read_file_contents( file, contents );
+            BOOST_CHECK_EQUAL( expected, contents );
+         }
+
+   // no temporary files are left behind
+   size_t files = 0;
+   for( fc::directory_iterator itr( dir.path() ); itr != fc::directory_iterator(); ++itr )
+      ++files;
+   BOOST_CHECK_EQUAL( 1u, files );
+
+   // the old behaviour of the plain overloads is kept
+   fc::json::save_to_file( v, file, false, fc::json::stringify_large_ints_and_doubles, 10 );
+   fc::read_file_contents( file, contents );
+   BOOST_CHECK_EQUAL( fc::json::to_string( v, fc::json::stringify_large_ints_and_doubles, 10 ), contents );
+   fc::json::save_to_file( derived, file.generic_string(), true, fc::json::stringify_large_ints_and_doubles, 10 );
+   fc::read_file_contents( file, contents );
+   BOOST_CHECK_EQUAL( fc::json::to_pretty_string( v, fc::json::stringify_large_ints_and_doubles, 10 ), contents );
+
+   // a failed atomic save keeps the previous file
+   fc::json::save_options opts;
+   opts.atomic_replace = true;
+   opts.max_depth = 3;
+   opts.buffer_size = 1;
+   BOOST_CHECK_THROW( fc::json::save_to_file( v, file, opts ), fc::assert_exception );
+   fc::read_file_contents( file, contents );
+   BOOST_CHECK_EQUAL( fc::json::to_pretty_string( v, fc::json::stringify_large_ints_and_doubles, 10 ), contents );
+   files = 0;
+   for( fc::directory_iterator itr( dir.path() ); itr != fc::directory_iterator(); ++itr )
+      ++files;
+   BOOST_CHECK_EQUAL( 1u, files );
+
+   BOOST_CHECK_THROW( fc::json::save_to_file( v, dir.path() / "missing" / "saved.json", opts ), fc::exception );
+
+#ifndef _WIN32
+   // replacing a file keeps its mode
+   BOOST_REQUIRE_EQUAL( 0, chmod( file.string().c_str(), 0604 ) );
+   opts.max_depth = 10;
+   fc::json::save_to_file( v, file, opts );
+   struct stat st;
+   BOOST_REQUIRE_EQUAL( 0, stat( file.string().c_str(), &st ) );
+   BOOST_CHECK_EQUAL( 0604, st.st_mode & 07777 );
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(save_large_file)
+{
+   // the 200 MB measurement only runs with FC_TEST_LARGE_FILES set, by default a small file is saved
+   const uint32_t count = getenv( "FC_TEST_LARGE_FILES" ) ? 400000 : 4000;
+   fc::variants items;
+   items.reserve( count );
+   for( uint32_t i = 0; i < count; ++i )
+      items.emplace_back( fc::mutable_variant_object( "id", "1.11." + std::to_string( i ) )
+                                                    ( "amount", i * 12345 )
+                                                    ( "memo", std::string( 420, 'a' + i % 26 ) )
+                                                    ( "tags", fc::variants{ fc::variant( i ), fc::variant( "x" ) } ) );
+   const fc::variant v( std::move( items ) );
+
+   fc::temp_directory dir;
+   const fc::path file = dir.path() / "large.json";
+   const uint64_t rss_start = peak_rss_mb();
+   fc::time_point start = fc::time_point::now();
+   fc::json::save_to_file( v, file );
+   fc::time_point streamed = fc::time_point::now();
+   const uint64_t rss_streamed = peak_rss_mb();
+   fc::json::save_options opts;
+   opts.atomic_replace = true;
+   opts.sync = fc::json::sync_file_and_directory;
+   fc::json::save_to_file( v, file, opts );
+   fc::time_point synced = fc::time_point::now();
+   {
+      // what save_to_file() used to do
+      const std::string text = fc::json::to_pretty_string( v );
+      fc::ofstream out( file );
+      out.write( text.data(), text.size() );
+   }
+   fc::time_point whole = fc::time_point::now();
+
+   const uint64_t size = fc::file_size( file );
+   BOOST_CHECK_GT( size, count * 500u );
+   BOOST_CHECK_EQUAL( count, fc::json::from_file( file ).get_array().size() );
+   auto mb_per_s = [size]( const fc::microseconds& d ) { return size / std::max<int64_t>( 1, d.count() ); };
+   BOOST_TEST_MESSAGE( "saving " << size / 1000000 << " MB of pretty JSON: streamed " << mb_per_s( streamed - start )
+                       << " MB/s, peak RSS +" << rss_streamed - rss_start << " MB; atomic with fsync "
+                       << mb_per_s( synced - streamed ) << " MB/s; whole string first " << mb_per_s( whole - synced )
+                       << " MB/s, peak RSS +" << peak_rss_mb() - rss_streamed << " MB" );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -1,7 +1,12 @@
 #include <boost/test/unit_test.hpp>
 
 #include <fc/network/tcp_socket.hpp>
+#include <fc/network/ip.hpp>
 #include <fc/asio.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/time.hpp>
+
+#include "../allocation_counter.hpp"
 
 namespace fc { namespace test {
 
@@ -55,4 +60,57 @@ BOOST_AUTO_TEST_CASE( default_number_threads_test )
    BOOST_CHECK( my_class.get_num_threads() > 1 );
 }
 
+/***
+ * Small messages bounced over loopback, every round trip is two reads and two
+ * writes of tcp_socket
+ */
+BOOST_AUTO_TEST_CASE( ping_pong_benchmark )
+{
+   const fc::ip::address localhost( "127.0.0.1" );
+   fc::tcp_server server;
+   server.listen( fc::ip::endpoint( localhost, 0 ) );
+   fc::tcp_socket client;
+   fc::tcp_socket peer;
+   fc::future<void> accepted = fc::async( [&server,&peer]() { server.accept( peer ); }, "accept" );
+   client.connect_to( fc::ip::endpoint( localhost, server.get_port() ) );
+   accepted.wait();
+
+   const uint32_t rounds = 20000;
+   const size_t   size = 32;
+   fc::future<void> echo = fc::async( [&peer,rounds,size]() {
+      char buffer[size];
+      for( uint32_t i = 0; i < rounds; ++i )
+      {
+         peer.read( buffer, size );
+         peer.write( buffer, size );
+      }
+   }, "echo" );
+
+   char message[size] = "ping";
+   char reply[size] = {};
+   fc::test::allocation_counter allocations( fc::test::allocation_counter::all_threads );
+   fc::time_point start = fc::time_point::now();
+   for( uint32_t i = 0; i < rounds; ++i )
+   {
+      message[size - 1] = char( i );
+      client.write( message, size );
+      client.read( reply, size );
+      BOOST_REQUIRE_EQUAL( message[size - 1], reply[size - 1] );
+   }
+   echo.wait();
+   fc::time_point end = fc::time_point::now();
+   const uint64_t socket_operations = 4 * rounds;
+
+   BOOST_TEST_MESSAGE( "loopback ping-pong of " << size << " bytes: "
+                       << socket_operations * 1000000 / std::max<int64_t>( 1, ( end - start ).count() )
+                       << " socket operations per second, "
+                       << double( allocations.count() ) / socket_operations
+                       << " allocations per operation" );
+
+   // a closed peer still ends a read with eof
+   peer.close();
+   char c;
+   BOOST_CHECK_THROW( client.readsome( &c, 1 ), fc::eof_exception );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
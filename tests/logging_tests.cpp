@@ -13,6 +13,7 @@
 #include <fc/io/json.hpp>
 #include <fc/io/fstream.hpp>
 
+#include <algorithm>
 #include <thread>
 #include <iostream>
 #include <fstream>
@@ -79,4 +80,179 @@ BOOST_AUTO_TEST_CASE(log_reboot)
     BOOST_TEST_MESSAGE("Loop complete");
 }
 
+static fc::log_message numbered_log_message( int i )
+{
+    fc::log_context ctx( fc::log_level::all, "my_file.cpp", i, "my_method()" );
+    return fc::log_message( ctx, "message ${i}", fc::mutable_variant_object( "i", i ) );
+}
+
+static std::vector<std::string> read_lines( const fc::path& p )
+{
+    std::vector<std::string> lines;
+    std::ifstream in( p.string() );
+    for( std::string line; std::getline( in, line ); )
+       lines.push_back( line );
+    return lines;
+}
+
+BOOST_AUTO_TEST_CASE(async_file_appender)
+{
+    fc::temp_directory log_dir;
+    fc::file_appender::config conf( log_dir.path() / "async.log" );
+    conf.async = true;
+    conf.async_queue_size = 64;
+    const int count = 5000;
+    {
+       fc::file_appender fa( fc::variant( conf, 200 ) );
+       for( int i = 0; i < count; ++i )
+          fa.log( numbered_log_message( i ) );
+       BOOST_CHECK_EQUAL( 0u, fa.dropped_messages() );
+    } // writes the rest of the queue
+
+    std::vector<std::string> lines = read_lines( conf.filename );
+    BOOST_REQUIRE_EQUAL( count, lines.size() );
+    for( int i = 0; i < count; ++i )
+    {
+       BOOST_CHECK( lines[i].find( "message " + std::to_string(i) + "\t" ) != std::string::npos );
+       BOOST_CHECK( lines[i].find( "my_file.cpp:" + std::to_string(i) ) != std::string::npos );
+    }
+
+    // dropping: what is not written is counted, and the count is written too
+    conf.filename = log_dir.path() / "dropping.log";
+    conf.async_queue_size = 4;
+    conf.async_overflow = fc::file_appender::overflow::drop;
+    uint64_t dropped;
+    {
+       fc::file_appender fa( fc::variant( conf, 200 ) );
+       for( int i = 0; i < count; ++i )
+          fa.log( numbered_log_message( i ) );
+       dropped = fa.dropped_messages();
+    }
+    lines = read_lines( conf.filename );
+    uint64_t written = 0;
+    uint64_t reported = 0;
+    int last = -1;
+    for( const auto& line : lines )
+    {
+       if( line.find( "file_appender: " ) == 0 )
+       {
+          reported += std::stoull( line.substr( 15 ) );
+          continue;
+       }
+       ++written;
+       int i = std::stoi( line.substr( line.rfind( ':' ) + 1 ) );
+       BOOST_CHECK_GT( i, last );
+       last = i;
+    }
+    BOOST_CHECK_EQUAL( count, written + dropped );
+    BOOST_CHECK_EQUAL( dropped, reported );
+    BOOST_TEST_MESSAGE( "dropped " << dropped << " of " << count << " messages with a queue of 4" );
+}
+
+BOOST_AUTO_TEST_CASE(async_file_appender_rotation)
+{
+    fc::temp_directory log_dir;
+    fc::file_appender::config conf( log_dir.path() / "rotating.log" );
+    conf.async = true;
+    conf.rotate = true;
+    conf.rotation_interval = fc::seconds(1);
+    conf.rotation_limit = fc::seconds(10);
+    {
+       fc::file_appender fa( fc::variant( conf, 200 ) );
+       fa.log( numbered_log_message( 1 ) );
+       fc::usleep( fc::milliseconds(1100) );
+       fa.log( numbered_log_message( 2 ) );
+    }
+
+    std::vector<std::string> files;
+    for( fc::directory_iterator itr( log_dir.path() ); itr != fc::directory_iterator(); ++itr )
+       if( itr->filename().string() != "rotating.log" )
+          files.push_back( itr->filename().string() );
+    std::sort( files.begin(), files.end() );
+    BOOST_REQUIRE_EQUAL( 2u, files.size() );
+    std::vector<std::string> first = read_lines( log_dir.path() / files[0] );
+    std::vector<std::string> second = read_lines( log_dir.path() / files[1] );
+    BOOST_REQUIRE_EQUAL( 1u, first.size() );
+    BOOST_REQUIRE_EQUAL( 1u, second.size() );
+    BOOST_CHECK( first[0].find( "my_file.cpp:1" ) != std::string::npos );
+    BOOST_CHECK( second[0].find( "my_file.cpp:2" ) != std::string::npos );
+    // the link follows the current file
+    BOOST_CHECK( read_lines( conf.filename ) == second );
+}
+
+BOOST_AUTO_TEST_CASE(file_appender_benchmark)
+{
+    fc::temp_directory log_dir;
+    const int count = 20000;
+    for( bool async : { false, true } )
+    {
+       fc::file_appender::config conf( log_dir.path() / ( async ? "async.log" : "sync.log" ) );
+       conf.async = async;
+       conf.flush = true;
+       fc::time_point start, logged;
+       {
+          fc::file_appender fa( fc::variant( conf, 200 ) );
+          std::vector<fc::log_message> messages;
+          for( int i = 0; i < count; ++i )
+             messages.push_back( numbered_log_message( i ) );
+          start = fc::time_point::now();
+          for( const auto& m : messages )
+             fa.log( m );
+          logged = fc::time_point::now();
+       }
+       fc::time_point written = fc::time_point::now();
+       BOOST_CHECK_EQUAL( count, read_lines( conf.filename ).size() );
+       BOOST_TEST_MESSAGE( ( async ? "async" : "sync " ) << " file_appender with flush: "
+                           << ( logged - start ).count() * 1000 / count << " ns per log() call, "
+                           << ( written - start ).count() / 1000 << " ms until written" );
+    }
+}
+
+namespace {
+   /** Formats every message like the console and file appenders do, and keeps the last one */
+   class formatting_appender : public fc::appender
+   {
+      public:
+         void log( const fc::log_message& m )override
+         {
+            text = fc::format_string( m.get_format(), m.get_data() );
+            last = m;
+            ++count;
+         }
+         fc::log_message last;
+         std::string     text;
+         uint64_t        count = 0;
+   };
+}
+
+BOOST_AUTO_TEST_CASE(log_call_benchmark)
+{
+    auto app = std::make_shared<formatting_appender>();
+    fc::logger log( "log_call_benchmark" );
+    log.set_log_level( fc::log_level::info );
+    log.add_appender( app );
+
+    const int count = 200000;
+    fc::time_point start = fc::time_point::now();
+    for( int i = 0; i < count; ++i )
+       fc_ilog( log, "call ${i} of a benchmark named ${name}", ("i",i)("name","log_call_benchmark") );
+    fc::time_point logged = fc::time_point::now();
+    BOOST_TEST_MESSAGE( "formatted fc_ilog with 2 arguments: " << ( logged - start ).count() * 1000 / count
+                        << " ns per call" );
+
+    BOOST_CHECK_EQUAL( count, app->count );
+    BOOST_CHECK_EQUAL( "call 199999 of a benchmark named log_call_benchmark", app->text );
+    fc::log_context ctx = app->last.get_context();
+    BOOST_CHECK_EQUAL( "logging_tests.cpp", ctx.get_file() );
+    BOOST_CHECK_EQUAL( "test_method", ctx.get_method() );
+    BOOST_CHECK_EQUAL( "call 199999 of a benchmark named log_call_benchmark", app->last.get_message() );
+
+    start = fc::time_point::now();
+    for( int i = 0; i < count; ++i )
+       fc_dlog( log, "call ${i} of a benchmark named ${name}", ("i",i)("name","log_call_benchmark") );
+    logged = fc::time_point::now();
+    BOOST_TEST_MESSAGE( "disabled fc_dlog: " << ( logged - start ).count() * 1000 / count << " ns per call" );
+    BOOST_CHECK_EQUAL( count, app->count );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -3,8 +3,11 @@
 #include <fc/network/http/websocket.hpp>
 
 #include <iostream>
+#include <mutex>
+#include <set>
 #include <fc/log/logger.hpp>
 #include <fc/log/console_appender.hpp>
+#include <fc/thread/thread.hpp>
 
 BOOST_AUTO_TEST_SUITE(fc_network)
 
@@ -162,4 +165,181 @@ BOOST_AUTO_TEST_CASE(websocket_test_with_proxy_header)
     l.set_log_level(old_log_level);
 }
 
+BOOST_AUTO_TEST_CASE(websocket_inbound_queue_test)
+{
+    // a client handles one connection
+    fc::http::websocket_client slow_client, fast_client;
+    fc::http::websocket_connection_ptr slow_conn, fast_conn;
+    {
+        fc::http::websocket_server server("");
+        server.set_inbound_limits( 4, 1 );
+        uint32_t slow_handled = 0;
+        uint32_t slow_handled_before_fast = 0;
+        server.on_connection([&]( const fc::http::websocket_connection_ptr& c ){
+                c->on_message_handler([&,c](const std::string& s){
+                    if( s == "slow" )
+                    {
+                        fc::usleep( fc::milliseconds(20) );
+                        ++slow_handled;
+                    }
+                    else
+                        slow_handled_before_fast = slow_handled;
+                    c->send_message( s );
+                });
+            });
+
+        server.listen( 0 );
+        int port = server.get_listening_port();
+        server.start_accept();
+
+        uint32_t slow_replies = 0;
+        std::string fast_reply;
+        slow_conn = slow_client.connect( "ws://localhost:" + fc::to_string(port) );
+        slow_conn->on_message_handler([&](const std::string& s){ ++slow_replies; });
+        fast_conn = fast_client.connect( "ws://localhost:" + fc::to_string(port) );
+        fast_conn->on_message_handler([&](const std::string& s){ fast_reply = s; });
+
+        for( int i = 0; i < 20; ++i )
+           slow_conn->send_message( "slow" );
+        fc::usleep( fc::milliseconds(50) );
+
+        fc::http::websocket_server_stats stats = server.get_stats();
+        BOOST_CHECK_EQUAL( 4u, stats.max_queued_messages );
+        BOOST_CHECK_EQUAL( 1u, stats.max_workers );
+        BOOST_CHECK_EQUAL( 1u, stats.workers );
+        BOOST_CHECK_EQUAL( 1u, stats.busy_workers );
+        BOOST_CHECK_GE( stats.read_pauses, 1u );
+        BOOST_REQUIRE_EQUAL( 2u, stats.connections.size() );
+        uint32_t paused = 0;
+        for( const auto& con : stats.connections )
+           paused += con.reading_paused;
+        BOOST_CHECK_EQUAL( 1u, paused );
+
+        // the queue of the other connection gets the next turn
+        fast_conn->send_message( "fast" );
+        // note: fc::usleep() does not yield for 10ms or less
+        for( int i = 0; i < 50 && fast_reply.empty(); ++i )
+           fc::usleep( fc::milliseconds(20) );
+        BOOST_CHECK_EQUAL( "fast", fast_reply );
+        BOOST_CHECK_LT( slow_handled_before_fast, 10u );
+
+        // reading is resumed once the queue is drained
+        for( int i = 0; i < 100 && slow_replies < 20; ++i )
+           fc::usleep( fc::milliseconds(20) );
+        BOOST_CHECK_EQUAL( 20u, slow_replies );
+        slow_conn->send_message( "slow" );
+        for( int i = 0; i < 50 && slow_replies < 21; ++i )
+           fc::usleep( fc::milliseconds(20) );
+        BOOST_CHECK_EQUAL( 21u, slow_replies );
+        stats = server.get_stats();
+        BOOST_CHECK_EQUAL( 0u, stats.queued_messages );
+        BOOST_CHECK_EQUAL( 22u, stats.dispatched_messages );
+        BOOST_CHECK_EQUAL( 0u, stats.dropped_messages );
+        for( const auto& con : stats.connections )
+        {
+           BOOST_CHECK_EQUAL( 0u, con.queued_messages );
+           BOOST_CHECK( !con.reading_paused );
+        }
+
+        slow_client.synchronous_close();
+        fast_client.synchronous_close();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(websocket_shard_test)
+{
+    std::vector<std::unique_ptr<fc::http::websocket_client>> clients;
+    std::vector<fc::http::websocket_connection_ptr> conns;
+    {
+        fc::http::websocket_server server( "", 3 );
+        std::mutex handler_threads_mutex;
+        std::set<fc::thread*> handler_threads;
+        server.on_connection([&]( const fc::http::websocket_connection_ptr& c ){
+                c->on_message_handler([&,c](const std::string& s){
+                    {
+                        std::lock_guard<std::mutex> lock( handler_threads_mutex );
+                        handler_threads.insert( &fc::thread::current() );
+                    }
+                    c->send_message( "echo: " + s );
+                });
+            });
+        server.listen( 0 );
+        int port = server.get_listening_port();
+        server.start_accept();
+
+        std::vector<std::string> replies( 6 );
+        for( size_t i = 0; i < replies.size(); ++i )
+        {
+           clients.emplace_back( new fc::http::websocket_client );
+           conns.push_back( clients.back()->connect( "ws://localhost:" + fc::to_string(port) ) );
+           conns.back()->on_message_handler([&replies,i](const std::string& s){ replies[i] = s; });
+        }
+        for( size_t i = 0; i < conns.size(); ++i )
+           conns[i]->send_message( fc::to_string( uint64_t(i) ) );
+        for( int i = 0; i < 50 && replies.back().empty(); ++i )
+           fc::usleep( fc::milliseconds(20) );
+        fc::usleep( fc::milliseconds(20) );
+        for( size_t i = 0; i < replies.size(); ++i )
+           BOOST_CHECK_EQUAL( "echo: " + fc::to_string( uint64_t(i) ), replies[i] );
+
+        fc::http::websocket_server_stats stats = server.get_stats();
+        BOOST_CHECK_EQUAL( 3u, stats.shards );
+        BOOST_REQUIRE_EQUAL( 6u, stats.connections.size() );
+        std::vector<uint32_t> per_shard( 3 );
+        for( const auto& con : stats.connections )
+           ++per_shard.at( con.shard );
+        BOOST_CHECK_EQUAL( 2u, per_shard[0] );
+        BOOST_CHECK_EQUAL( 2u, per_shard[1] );
+        BOOST_CHECK_EQUAL( 2u, per_shard[2] );
+        BOOST_CHECK_EQUAL( 3u, handler_threads.size() );
+        BOOST_CHECK( handler_threads.count( &fc::thread::current() ) );
+
+        for( auto& client : clients )
+           client->synchronous_close();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(websocket_shard_benchmark)
+{
+    const uint32_t client_count = 8;
+    const uint32_t message_count = 1000;
+    for( uint32_t shards : { 1, 2, 4 } )
+    {
+        std::vector<std::unique_ptr<fc::http::websocket_client>> clients;
+        fc::http::websocket_server server( "", shards );
+        server.on_connection([&]( const fc::http::websocket_connection_ptr& c ){
+                c->on_message_handler([c](const std::string& s){
+                    c->send_message( s );
+                });
+            });
+        server.listen( 0 );
+        int port = server.get_listening_port();
+        server.start_accept();
+
+        uint32_t replies = 0;
+        std::vector<fc::http::websocket_connection_ptr> conns;
+        for( uint32_t i = 0; i < client_count; ++i )
+        {
+           clients.emplace_back( new fc::http::websocket_client );
+           conns.push_back( clients.back()->connect( "ws://localhost:" + fc::to_string(port) ) );
+           conns.back()->on_message_handler([&replies](const std::string& s){ ++replies; });
+        }
+
+        auto start = fc::time_point::now();
+        for( uint32_t m = 0; m < message_count; ++m )
+           for( auto& con : conns )
+              con->send_message( "{\"id\":1,\"method\":\"call\",\"params\":[0,\"get_block\",[12345]]}" );
+        while( replies < client_count * message_count && fc::time_point::now() - start < fc::seconds(60) )
+           fc::usleep( fc::milliseconds(20) );
+        auto elapsed = fc::time_point::now() - start;
+        BOOST_CHECK_EQUAL( client_count * message_count, replies );
+        BOOST_TEST_MESSAGE( "websocket echo with " << shards << " shard(s), " << client_count << " clients: "
+                            << uint64_t(replies) * 1000000 / std::max<int64_t>( elapsed.count(), 1 )
+                            << " messages/sec" );
+
+        for( auto& client : clients )
+           client->synchronous_close();
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -2,7 +2,18 @@
 #include <fc/log/logger.hpp>
 
 #include <fc/container/flat.hpp>
+#include <fc/crypto/sha256.hpp>
+#include <fc/io/fstream.hpp>
 #include <fc/io/raw.hpp>
+#include <fc/time.hpp>
+
+#include <deque>
+#include <fstream>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
 
 namespace fc { namespace test {
 
@@ -35,10 +46,52 @@ namespace fc { namespace test {
    inline bool operator < ( const item& a, const item& b )
    { return ( std::tie( a.level, a.w ) < std::tie( b.level, b.w ) ); }
 
+   struct blob
+   {
+      std::string           name;
+      std::vector<uint32_t> ids;
+      std::vector<char>     payload;
+   };
+
+   struct blob_view
+   {
+      boost::string_view         name;
+      fc::raw::pod_view<uint32_t> ids;
+      fc::raw::bytes_view        payload;
+   };
+
+   struct bench_operation
+   {
+      uint32_t              kind = 0;
+      std::string           memo;
+      std::vector<uint64_t> amounts;
+      fc::optional<item>    extension;
+   };
+
+   struct bench_transaction
+   {
+      uint32_t                     ref_block = 0;
+      fc::time_point_sec           expiration;
+      std::vector<bench_operation> operations;
+      std::vector<std::string>     signatures;
+   };
+
+   struct bench_block
+   {
+      fc::sha256                     previous;
+      uint32_t                       timestamp = 0;
+      std::vector<bench_transaction> transactions;
+   };
+
 } } // namespace fc::test
 
 FC_REFLECT( fc::test::item_wrapper, (v) );
 FC_REFLECT( fc::test::item, (level)(w) );
+FC_REFLECT( fc::test::blob, (name)(ids)(payload) );
+FC_REFLECT( fc::test::blob_view, (name)(ids)(payload) );
+FC_REFLECT( fc::test::bench_operation, (kind)(memo)(amounts)(extension) );
+FC_REFLECT( fc::test::bench_transaction, (ref_block)(expiration)(operations)(signatures) );
+FC_REFLECT( fc::test::bench_block, (previous)(timestamp)(transactions) );
 
 BOOST_AUTO_TEST_SUITE(fc_serialization)
 
@@ -121,4 +174,210 @@ BOOST_AUTO_TEST_CASE( unpack_recursion_test )
    FC_LOG_AND_RETHROW();
 }
 
+BOOST_AUTO_TEST_CASE( unpack_views_test )
+{ try {
+   fc::test::blob b;
+   b.name = "block";
+   b.ids = { 1, 0x01020304, 0xffffffff };
+   b.payload.resize( 100000, 'x' );
+   std::vector<char> packed = fc::raw::pack( b );
+
+   fc::datastream<const char*> ds( packed.data(), packed.size() );
+   fc::test::blob_view v;
+   fc::raw::unpack( ds, v );
+   BOOST_CHECK_EQUAL( 0u, ds.remaining() );
+   BOOST_CHECK_EQUAL( b.name, v.name.to_string() );
+   BOOST_REQUIRE_EQUAL( b.ids.size(), v.ids.size() );
+   for( size_t i = 0; i < b.ids.size(); ++i )
+      BOOST_CHECK_EQUAL( b.ids[i], v.ids[i] );
+   BOOST_CHECK( b.payload == v.payload.to_vector() );
+   // the views point into the packed buffer
+   BOOST_CHECK( v.payload.data() >= packed.data() && v.payload.end() == packed.data() + packed.size() );
+
+   // views pack exactly like the containers they replace
+   BOOST_CHECK( packed == fc::raw::pack( v ) );
+
+   // truncated input and depth limits are checked like for the owning containers
+   fc::datastream<const char*> short_ds( packed.data(), packed.size() - 1 );
+   BOOST_CHECK_THROW( fc::raw::unpack( short_ds, v ), fc::exception );
+   fc::datastream<const char*> ds2( packed.data(), packed.size() );
+   fc::raw::bytes_view bytes;
+   BOOST_CHECK_THROW( fc::raw::unpack( ds2, bytes, 0 ), fc::assert_exception );
+
+   std::vector<char> empty = fc::raw::pack( std::vector<char>() );
+   fc::datastream<const char*> ds3( empty.data(), empty.size() );
+   fc::raw::unpack( ds3, bytes );
+   BOOST_CHECK( bytes.empty() );
+} FC_LOG_AND_RETHROW() }
+
+template<typename T>
+static void bulk_pack_benchmark( const std::vector<T>& items, const char* name )
+{
+   // the same elements in a deque take the element by element path
+   const std::deque<T> slow_items( items.begin(), items.end() );
+
+   fc::time_point start = fc::time_point::now();
+   std::vector<char> packed = fc::raw::pack( items );
+   fc::time_point packed_time = fc::time_point::now();
+   std::vector<T> unpacked = fc::raw::unpack< std::vector<T> >( packed );
+   fc::time_point unpacked_time = fc::time_point::now();
+   std::vector<char> slow_packed = fc::raw::pack( slow_items );
+   fc::time_point slow_packed_time = fc::time_point::now();
+   std::deque<T> slow_unpacked = fc::raw::unpack< std::deque<T> >( slow_packed );
+   fc::time_point slow_unpacked_time = fc::time_point::now();
+
+   BOOST_CHECK( packed == slow_packed );
+   BOOST_CHECK( unpacked == items );
+   BOOST_CHECK( slow_unpacked == slow_items );
+
+   // streams without a known size still grow the vector step by step
+   std::stringstream ss;
+   fc::raw::pack( ss, items );
+   std::vector<T> streamed;
+   fc::raw::unpack( ss, streamed );
+   BOOST_CHECK( streamed == items );
+
+   BOOST_TEST_MESSAGE( items.size() << " " << name << ": bulk pack " << (packed_time - start).count()
+                       << "us, unpack " << (unpacked_time - packed_time).count()
+                       << "us; element-wise pack " << (slow_packed_time - unpacked_time).count()
+                       << "us, unpack " << (slow_unpacked_time - slow_packed_time).count() << "us" );
+}
+
+BOOST_AUTO_TEST_CASE( bulk_vector_pack_test )
+{ try {
+   const size_t count = 1000000;
+   std::vector<uint64_t> ints( count );
+   std::vector<fc::sha256> hashes( count );
+   for( size_t i = 0; i < count; ++i )
+   {
+      ints[i] = i * 0x9e3779b97f4a7c15ULL;
+      hashes[i]._hash[0] = ints[i];
+   }
+   bulk_pack_benchmark( ints, "uint64_t" );
+   bulk_pack_benchmark( hashes, "sha256" );
+
+   // only the integers with a pack/unpack are copied in bulk, the others have no portable wire format
+   static_assert( fc::raw::is_trivially_packed<int16_t>::value == ( boost::endian::order::native == boost::endian::order::little ), "" );
+   static_assert( !fc::raw::is_trivially_packed<bool>::value, "" );
+   static_assert( !fc::raw::is_trivially_packed<wchar_t>::value, "" );
+   static_assert( !fc::raw::is_trivially_packed<char16_t>::value, "" );
+   static_assert( !fc::raw::is_trivially_packed<char32_t>::value, "" );
+   static_assert( !fc::raw::is_trivially_packed<long long>::value || std::is_same<long long, int64_t>::value, "" );
+   static_assert( !fc::raw::is_trivially_packed<unsigned long>::value || std::is_same<unsigned long, uint64_t>::value
+                  || std::is_same<unsigned long, uint32_t>::value, "" );
+
+   // the wire format is unchanged, elements are little endian
+   std::vector<uint32_t> small = { 0x01020304 };
+   std::vector<char> expected = { 1, 4, 3, 2, 1 };
+   BOOST_CHECK( fc::raw::pack( small ) == expected );
+
+   // a length prefix larger than the data fails before allocating for it
+   std::vector<char> truncated = fc::raw::pack( fc::unsigned_int( 1000000000 ) );
+   BOOST_CHECK_THROW( fc::raw::unpack< std::vector<uint64_t> >( truncated ), fc::exception );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( single_pass_pack_test )
+{ try {
+   fc::test::bench_block block;
+   for( uint32_t t = 0; t < 200; ++t )
+   {
+      fc::test::bench_transaction trx;
+      trx.ref_block = t;
+      trx.expiration = fc::time_point_sec( 1000000 + t );
+      for( uint32_t o = 0; o < 5; ++o )
+      {
+         fc::test::bench_operation op;
+         op.kind = o;
+         op.memo = "operation " + std::to_string( t * 5 + o );
+         op.amounts = { t, o, uint64_t(t) * o };
+         if( o % 2 )
+            op.extension = fc::test::item( fc::test::item_wrapper( fc::test::item( o ) ), t );
+         trx.operations.push_back( std::move( op ) );
+      }
+      trx.signatures.push_back( std::string( 65, char( t ) ) );
+      block.transactions.push_back( std::move( trx ) );
+   }
+
+   const std::vector<char> expected = fc::raw::pack( block );
+   std::vector<char> buf;
+   fc::raw::pack_to_vector( buf, block );
+   BOOST_CHECK( buf == expected );
+   // previous contents are replaced
+   fc::raw::pack_to_vector( buf, block );
+   BOOST_CHECK( buf == expected );
+   BOOST_CHECK( fc::raw::unpack<fc::test::bench_block>( buf ).transactions.size() == 200 );
+
+   const uint32_t rounds = 200;
+   fc::time_point start = fc::time_point::now();
+   for( uint32_t i = 0; i < rounds; ++i )
+      BOOST_REQUIRE_EQUAL( expected.size(), fc::raw::pack( block ).size() );
+   fc::time_point two_pass = fc::time_point::now();
+   for( uint32_t i = 0; i < rounds; ++i )
+   {
+      std::vector<char> fresh;
+      fc::raw::pack_to_vector( fresh, block );
+      BOOST_REQUIRE_EQUAL( expected.size(), fresh.size() );
+   }
+   fc::time_point one_pass = fc::time_point::now();
+   for( uint32_t i = 0; i < rounds; ++i )
+   {
+      fc::raw::pack_to_vector( buf, block );
+      BOOST_REQUIRE_EQUAL( expected.size(), buf.size() );
+   }
+   fc::time_point scratch = fc::time_point::now();
+   BOOST_TEST_MESSAGE( rounds << " packs of a " << expected.size() << " byte block: two-pass "
+                       << (two_pass - start).count() << "us, one-pass " << (one_pass - two_pass).count()
+                       << "us, one-pass into a reused buffer " << (scratch - one_pass).count() << "us" );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( unpack_file_test )
+{ try {
+   std::vector<fc::test::blob> blobs( 2000 );
+   for( size_t i = 0; i < blobs.size(); ++i )
+   {
+      blobs[i].name = "blob " + std::to_string( i );
+      blobs[i].ids = { uint32_t(i), uint32_t(i * 2) };
+      blobs[i].payload.resize( 10000, char( i ) );
+   }
+   const std::vector<char> packed = fc::raw::pack( blobs );
+
+   fc::temp_directory dir;
+   const fc::path file = dir.path() / "blobs.bin";
+   {
+      std::ofstream out( file.generic_string(), std::ios::binary );
+      out.write( packed.data(), packed.size() );
+   }
+
+   fc::time_point start = fc::time_point::now();
+   std::vector<fc::test::blob> mapped = fc::raw::unpack_file< std::vector<fc::test::blob> >( file );
+   fc::time_point unpacked = fc::time_point::now();
+   std::string contents;
+   fc::read_file_contents( file, contents );
+   std::vector<fc::test::blob> buffered = fc::raw::unpack< std::vector<fc::test::blob> >( contents.data(), contents.size() );
+   fc::time_point read = fc::time_point::now();
+
+   BOOST_REQUIRE_EQUAL( blobs.size(), mapped.size() );
+   BOOST_CHECK( fc::raw::pack( mapped ) == packed );
+   BOOST_CHECK_EQUAL( blobs.size(), buffered.size() );
+   BOOST_TEST_MESSAGE( "unpacking " << packed.size() / 1000000 << " MB: unpack_file " << ( unpacked - start ).count() / 1000
+                       << " ms, read_file_contents and unpack " << ( read - unpacked ).count() / 1000 << " ms" );
+
+   { std::ofstream empty( ( dir.path() / "empty.bin" ).generic_string() ); }
+   BOOST_CHECK( fc::raw::unpack_file< std::vector<fc::test::blob> >( dir.path() / "empty.bin" ).empty() );
+   BOOST_CHECK_THROW( fc::raw::unpack_file< std::vector<fc::test::blob> >( dir.path() / "missing.bin" ), fc::exception );
+#ifndef _WIN32
+   // a FIFO can't be mapped and is read into a buffer instead
+   const fc::path fifo = dir.path() / "blobs.fifo";
+   BOOST_REQUIRE_EQUAL( 0, mkfifo( fifo.string().c_str(), 0600 ) );
+   std::thread writer( [&fifo,&packed]() {
+      std::ofstream( fifo.string(), std::ios::binary ).write( packed.data(), packed.size() );
+   } );
+   std::vector<fc::test::blob> streamed = fc::raw::unpack_file< std::vector<fc::test::blob> >( fifo );
+   writer.join();
+   BOOST_CHECK( fc::raw::pack( streamed ) == packed );
+#endif
+   std::ofstream( file.generic_string(), std::ios::binary ).write( packed.data(), packed.size() - 1 );
+   BOOST_CHECK_THROW( fc::raw::unpack_file< std::vector<fc::test::blob> >( file ), fc::exception );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -136,6 +136,146 @@ BOOST_AUTO_TEST_CASE( do_something_parallel )
    }
 }
 
+BOOST_AUTO_TEST_CASE( nested_parallel )
+{
+   // tasks spawned from inside a worker must get done even if the spawning task waits for them
+   std::vector<fc::future<uint64_t>> results;
+   results.reserve( 100 );
+   for( uint64_t i = 0; i < results.capacity(); i++ )
+      results.push_back( fc::do_parallel( [i] () {
+         std::vector<fc::future<uint64_t>> inner;
+         inner.reserve( 10 );
+         for( uint64_t k = 0; k < inner.capacity(); k++ )
+            inner.push_back( fc::do_parallel( [i,k] () { return i * k; } ) );
+         uint64_t sum = 0;
+         for( auto& res : inner )
+            sum += res.wait();
+         return sum;
+      } ) );
+   for( uint64_t i = 0; i < results.size(); i++ )
+      BOOST_CHECK_EQUAL( i * 45, results[i].wait() );
+}
+
+BOOST_AUTO_TEST_CASE( pool_throughput )
+{
+   {
+      const uint32_t count = 100000;
+      boost::atomic<uint32_t> counter(0);
+      std::vector<fc::future<void>> results;
+      results.reserve( count );
+      fc::time_point start = fc::time_point::now();
+      for( uint32_t i = 0; i < count; i++ )
+         results.push_back( fc::do_parallel( [&counter] () { counter.fetch_add( 1, boost::memory_order_relaxed ); } ) );
+      for( auto& result : results )
+         result.wait();
+      fc::time_point end = fc::time_point::now();
+      BOOST_CHECK_EQUAL( count, counter.load() );
+      ilog( "${c} empty tasks in ${t}µs", ("c",count)("t",end-start) );
+   }
+
+   {
+      const uint32_t count = 10000;
+      fc::time_point start = fc::time_point::now();
+      for( uint32_t i = 0; i < count; i++ )
+         fc::do_parallel( [] () {} ).wait();
+      fc::time_point end = fc::time_point::now();
+      ilog( "${c} sequential round trips in ${t}µs", ("c",count)("t",end-start) );
+   }
+}
+
+BOOST_AUTO_TEST_CASE( parallel_for )
+{
+   std::vector<uint64_t> values( 10000 );
+   for( uint64_t i = 0; i < values.size(); i++ )
+      values[i] = i;
+
+   for( size_t grain : { 0, 1, 7, 10000, 20000 } )
+   {
+      boost::atomic<uint64_t> sum(0);
+      fc::parallel_for( values, [&sum] ( uint64_t v ) { sum.fetch_add( v ); }, grain ).wait();
+      BOOST_CHECK_EQUAL( 10000ull * 9999 / 2, sum.load() );
+   }
+
+   fc::parallel_for( values.begin(), values.end(), [] ( uint64_t& v ) { v *= 2; }, 100 ).wait();
+   for( uint64_t i = 0; i < values.size(); i++ )
+      BOOST_CHECK_EQUAL( 2 * i, values[i] );
+
+   // functors that are not const-callable are accepted
+   boost::atomic<uint64_t> doubled(0);
+   fc::parallel_for( values, [&doubled] ( uint64_t v ) mutable { doubled.fetch_add( v ); } ).wait();
+   BOOST_CHECK_EQUAL( 10000ull * 9999, doubled.load() );
+
+   std::vector<uint64_t> empty;
+   fc::parallel_for( empty, [] ( uint64_t ) { BOOST_FAIL( "must not be called" ); } ).wait();
+
+   boost::atomic<uint32_t> calls(0);
+   auto failing = fc::parallel_for( values, [&calls] ( uint64_t v ) {
+      calls.fetch_add( 1 );
+      FC_ASSERT( v != 1000, "first" );
+   }, 10 );
+   BOOST_CHECK_THROW( failing.wait(), fc::assert_exception );
+   BOOST_CHECK( calls.load() <= values.size() );
+
+   // other exceptions keep their message
+   auto throwing = fc::parallel_for( values, [] ( uint64_t v ) {
+      if( v == 1000 )
+         throw std::runtime_error( "parallel_for runtime error" );
+   } );
+   BOOST_CHECK_EXCEPTION( throwing.wait(), std::runtime_error,
+                          [] ( const std::runtime_error& e ) { return std::string( e.what() ) == "parallel_for runtime error"; } );
+}
+
+BOOST_AUTO_TEST_CASE( parallel_transform )
+{
+   std::vector<std::string> in;
+   in.reserve( 1000 );
+   for( int i = 0; i < 1000; i++ )
+      in.push_back( TEXT + fc::to_string(i) );
+
+   std::vector<fc::sha256> out( in.size() );
+   fc::parallel_transform( in, out, [] ( const std::string& s ) { return fc::sha256::hash( s ); } ).wait();
+   for( size_t i = 0; i < in.size(); i++ )
+      BOOST_CHECK( fc::sha256::hash( in[i] ) == out[i] );
+
+   std::vector<size_t> sizes( in.size() );
+   fc::parallel_transform( in, sizes, [] ( const std::string& s ) mutable { return s.size(); } ).wait();
+   BOOST_CHECK_EQUAL( in.back().size(), sizes.back() );
+
+   std::vector<fc::sha256> too_small( 10 );
+   BOOST_CHECK_THROW( fc::parallel_transform( in, too_small, [] ( const std::string& s ) { return fc::sha256::hash( s ); } ),
+                      fc::assert_exception );
+}
+
+BOOST_AUTO_TEST_CASE( parallel_for_vs_do_parallel )
+{
+   const size_t count = 100000;
+   std::vector<fc::sha256> hashes( count );
+   for( size_t i = 0; i < count; i++ )
+      hashes[i] = fc::sha256::hash( TEXT + fc::to_string(i) );
+
+   std::vector<fc::sha256> out( count );
+   {
+      std::vector<fc::future<void>> results;
+      results.reserve( count );
+      fc::time_point start = fc::time_point::now();
+      for( size_t i = 0; i < count; i++ )
+         results.push_back( fc::do_parallel( [&hashes,&out,i] () { out[i] = fc::sha256::hash( hashes[i] ); } ) );
+      for( auto& result : results )
+         result.wait();
+      fc::time_point end = fc::time_point::now();
+      ilog( "${c} hashes with do_parallel in ${t}µs", ("c",count)("t",end-start) );
+   }
+
+   std::vector<fc::sha256> out2( count );
+   {
+      fc::time_point start = fc::time_point::now();
+      fc::parallel_transform( hashes, out2, [] ( const fc::sha256& h ) { return fc::sha256::hash( h ); } ).wait();
+      fc::time_point end = fc::time_point::now();
+      ilog( "${c} hashes with parallel_transform in ${t}µs", ("c",count)("t",end-start) );
+   }
+   BOOST_CHECK( out == out2 );
+}
+
 BOOST_AUTO_TEST_CASE( hash_parallel )
 {
    hash_test<fc::ripemd160>().run();
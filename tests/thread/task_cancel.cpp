@@ -246,4 +246,90 @@ BOOST_AUTO_TEST_CASE( cancel_scheduled_task )
   }
 }
 
+BOOST_AUTO_TEST_CASE( cancel_scheduled_task_before_yielding )
+{
+  bool executed = false;
+  fc::time_point start = fc::time_point::now();
+  // the task has not left task_in_queue yet when it is canceled
+  fc::future<void> f = fc::schedule( [&executed]() { executed = true; },
+                                     fc::time_point::now() + fc::hours(1), "cancel_before_yielding" );
+  f.cancel_and_wait( "canceled from the scheduling thread" );
+  BOOST_CHECK( !executed );
+  BOOST_CHECK( f.canceled() );
+  BOOST_CHECK( fc::time_point::now() - start < fc::seconds(5) );
+}
+
+BOOST_AUTO_TEST_CASE( scheduled_timer_churn )
+{
+  fc::thread timer_thread("timer_churn");
+  timer_thread.async([]() {
+    const uint32_t pending_count = 100000;
+    const uint32_t churn_count = 20000;
+    const uint32_t wait_count = 500;
+    std::vector<fc::future<void>> pending;
+    pending.reserve(pending_count);
+    uint32_t executed = 0;
+
+    fc::time_point start = fc::time_point::now();
+    for (uint32_t i = 0; i < pending_count; ++i)
+      pending.push_back(fc::schedule([&executed]() { ++executed; },
+                                     start + fc::hours(1) + fc::microseconds((i * 7919) % pending_count),
+                                     "pending timer"));
+    fc::time_point scheduled = fc::time_point::now();
+
+    // replace random pending timers with new ones, letting the thread go idle now and then
+    for (uint32_t i = 0; i < churn_count; ++i)
+    {
+      fc::future<void>& victim = pending[(i * 104729) % pending_count];
+      victim.cancel("timer churn");
+      victim = fc::schedule([&executed]() { ++executed; },
+                            start + fc::hours(1) + fc::microseconds(i),
+                            "replacement timer");
+      if (i % 100 == 0)
+        fc::yield();
+    }
+    fc::time_point churned = fc::time_point::now();
+
+    // short timed waits that complete through a near scheduled task, with all the
+    // pending timers still queued
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < wait_count; ++i)
+    {
+      fc::promise<void>::ptr done = fc::promise<void>::create("timer churn wait");
+      fc::future<void> late = fc::schedule([&order]() { order.push_back(1); },
+                                           fc::time_point::now() + fc::milliseconds(2), "late timer");
+      fc::schedule([done, &order]() { order.push_back(0); done->set_value(); },
+                   fc::time_point::now() + fc::milliseconds(1), "early timer");
+      fc::future<void>(done).wait(fc::seconds(10));
+      late.wait();
+    }
+    fc::time_point waited = fc::time_point::now();
+
+    for (auto& timer : pending)
+      timer.cancel("timer churn finished");
+    uint32_t canceled = 0;
+    for (auto& timer : pending)
+    {
+      try
+      {
+        timer.wait(fc::seconds(10));
+      }
+      catch (const fc::canceled_exception&)
+      {
+        ++canceled;
+      }
+    }
+    fc::time_point finished = fc::time_point::now();
+
+    BOOST_CHECK_EQUAL(0u, executed);
+    BOOST_CHECK_EQUAL(pending_count, canceled);
+    BOOST_REQUIRE_EQUAL(2 * wait_count, order.size());
+    for (uint32_t i = 0; i < order.size(); ++i)
+      BOOST_CHECK_EQUAL(i % 2, order[i]);
+    ilog("${n} timers scheduled in ${a}µs, ${c} replaced in ${b}µs, ${w} timed waits in ${d}µs, canceled in ${e}µs",
+         ("n",pending_count)("a",scheduled - start)("c",churn_count)("b",churned - scheduled)
+         ("w",wait_count)("d",waited - churned)("e",finished - waited));
+  }, "timer churn").wait();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -4,7 +4,9 @@
 #include <fc/thread/thread.hpp>
 #include <fc/thread/mutex.hpp>
 #include <fc/thread/scoped_lock.hpp>
+#include <fc/thread/thread_stats.hpp>
 #include <fc/asio.hpp>
+#include <fc/reflect/variant.hpp>
 
 #include <iostream>
 
@@ -156,4 +158,116 @@ BOOST_AUTO_TEST_CASE( yield_with_mutex )
    BOOST_CHECK_EQUAL(0u, my_mutable);
 }
 
+static uint32_t use_stack(uint32_t bytes)
+{
+    volatile char frame[64 * 1024];
+    frame[0] = 1;
+    frame[sizeof(frame) - 1] = 1;
+    if (bytes <= sizeof(frame))
+        return frame[0];
+    return frame[sizeof(frame) - 1] + use_stack(bytes - sizeof(frame));
+}
+
+BOOST_AUTO_TEST_CASE(stack_size_classes)
+{
+    fc::thread thread("stacks");
+    thread.configure_stack_pool(stack_size_class::compact, 8, 4);
+    BOOST_CHECK_EQUAL(4u, thread.get_stack_pool_stats().cached);
+
+    // more than the default 2MB stack would hold
+    const uint32_t deep = 4 * 1024 * 1024;
+    BOOST_CHECK_EQUAL(deep / (64 * 1024),
+                      thread.async([deep]{ return use_stack(deep); }, "deep", priority(), stack_size_class::large).wait());
+
+    // a burst of blocking tasks needs one fiber each, later bursts reuse them or their stacks
+    const uint32_t burst_size = 64;
+    auto burst = [&thread, burst_size]() {
+        std::vector<fc::future<void>> sleepers;
+        for (uint32_t i = 0; i < burst_size; ++i)
+            sleepers.push_back(thread.async([]{ fc::usleep(fc::milliseconds(20)); }, "sleeper",
+                                            priority(), stack_size_class::compact));
+        for (auto& sleeper : sleepers)
+            sleeper.wait();
+        thread.async([]{}).wait(); // let exited fibers return their stacks
+    };
+
+    stack_pool_stats before = thread.get_stack_pool_stats();
+    burst();
+    stack_pool_stats first = thread.get_stack_pool_stats();
+    burst();
+    stack_pool_stats second = thread.get_stack_pool_stats();
+
+    BOOST_CHECK_GE(first.hits - before.hits, 4u);
+    BOOST_CHECK_GT(second.hits, first.hits);
+    BOOST_CHECK_LT(second.misses - first.misses, first.misses - before.misses);
+    BOOST_CHECK_LE(second.cached, 8u + 2 * 16u);
+    BOOST_TEST_MESSAGE("stack pool: first burst " << first.hits - before.hits << " hits, "
+                       << first.misses - before.misses << " misses, second burst "
+                       << second.hits - first.hits << " hits, " << second.misses - first.misses << " misses");
+}
+
+BOOST_AUTO_TEST_CASE(scheduler_stats)
+{
+    fc::thread thread("stats");
+    std::vector<fc::future<void>> tasks;
+    for (uint32_t i = 0; i < 100; ++i)
+        tasks.push_back(thread.async([]{}, "stats task"));
+    tasks.push_back(thread.async([]{ fc::usleep(fc::milliseconds(20)); }, "stats sleeper"));
+    for (auto& task : tasks)
+        task.wait();
+
+    thread_stats stats = thread.get_stats();
+    BOOST_CHECK_EQUAL("stats", stats.name);
+    BOOST_CHECK_GE(stats.tasks_run, 101u);
+    BOOST_CHECK_GT(stats.context_switches, 0u);
+
+    auto task_stats = std::find_if(stats.task_latency.begin(), stats.task_latency.end(),
+                                   [](const task_latency_stats& s) { return s.desc == "stats task"; });
+    BOOST_REQUIRE(task_stats != stats.task_latency.end());
+    BOOST_CHECK_EQUAL(100u, task_stats->count);
+    BOOST_REQUIRE_EQUAL(task_latency_stats::bucket_limits().size() + 1, task_stats->buckets.size());
+    uint64_t bucketed = 0;
+    for (uint64_t bucket : task_stats->buckets)
+        bucketed += bucket;
+    BOOST_CHECK_EQUAL(task_stats->count, bucketed);
+    BOOST_CHECK_LE(task_stats->max_us, task_stats->total_us);
+
+    fc::variant v(stats, 4);
+    BOOST_CHECK_EQUAL(stats.tasks_run, v.get_object()["tasks_run"].as_uint64());
+    BOOST_CHECK_EQUAL(stats.task_latency.size(), v.get_object()["task_latency"].get_array().size());
+}
+
+BOOST_AUTO_TEST_CASE(async_post_throughput)
+{
+    fc::thread target("target");
+    const uint32_t total_posts = 160000;
+    for (uint32_t producer_count : {1u, 4u, 16u})
+    {
+        std::vector<std::unique_ptr<fc::thread>> producers;
+        for (uint32_t i = 0; i < producer_count; ++i)
+            producers.emplace_back(new fc::thread("producer" + std::to_string(i)));
+
+        uint32_t executed = 0;
+        const uint32_t per_producer = total_posts / producer_count;
+        fc::time_point start = fc::time_point::now();
+        std::vector<fc::future<void>> done;
+        for (auto& producer : producers)
+            done.push_back(producer->async([&target, &executed, per_producer]() {
+                fc::future<void> last;
+                for (uint32_t i = 0; i < per_producer; ++i)
+                    last = target.async([&executed]{ ++executed; }, "post");
+                last.wait();
+            }));
+        for (auto& producer_done : done)
+            producer_done.wait();
+        fc::microseconds elapsed = fc::time_point::now() - start;
+
+        BOOST_CHECK_EQUAL(per_producer * producer_count, target.async([&executed]{ return executed; }).wait());
+        BOOST_TEST_MESSAGE(producer_count << " producers: " << per_producer * producer_count << " posts in "
+                           << elapsed.count() << "us, "
+                           << uint64_t(per_producer * producer_count) * 1000000 / std::max<int64_t>(elapsed.count(), 1)
+                           << " posts/sec");
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
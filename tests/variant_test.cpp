@@ -6,6 +6,10 @@
 #include <fc/reflect/variant.hpp>
 #include <fc/static_variant.hpp>
 #include <fc/log/logger_config.hpp>
+#include <fc/io/json.hpp>
+#include <fc/time.hpp>
+
+#include "allocation_counter.hpp"
 
 namespace fc { namespace test {
 
@@ -39,10 +43,90 @@ namespace fc { namespace test {
    { return ( std::tie( a.level, a.w ) < std::tie( b.level, b.w ) ); }
 
 
+   struct api_balance
+   {
+      std::string asset_id;
+      int64_t     amount = 0;
+   };
+
+   struct api_account
+   {
+      std::string              id;
+      std::string              name;
+      std::string              registrar;
+      fc::time_point_sec       expiration;
+      uint32_t                 flags = 0;
+      std::vector<api_balance> balances;
+      std::vector<std::string> votes;
+   };
+
+   /** One of the alternatives of a static_variant with many, like a blockchain operation */
+   template<int N>
+   struct sv_op
+   {
+      uint64_t              fee = N;
+      std::string           memo;
+      std::vector<uint32_t> ids;
+   };
+   template<int N>
+   bool operator == ( const sv_op<N>& a, const sv_op<N>& b )
+   { return std::tie( a.fee, a.memo, a.ids ) == std::tie( b.fee, b.memo, b.ids ); }
+
+   /** Too large to be stored inside a static_variant */
+   struct sv_large_op
+   {
+      std::array<char,1024> data;
+   };
+   inline bool operator == ( const sv_large_op& a, const sv_large_op& b ) { return a.data == b.data; }
+
+   /** Kept on the heap by specializing static_variant_inline_storage */
+   struct sv_boxed_op
+   {
+      std::string name;
+   };
+   inline bool operator == ( const sv_boxed_op& a, const sv_boxed_op& b ) { return a.name == b.name; }
+
+   template<typename Seq> struct make_sv_operation;
+   template<int... N> struct make_sv_operation< std::integer_sequence<int, N...> >
+   {
+      using type = fc::static_variant< sv_op<N>..., sv_large_op, sv_boxed_op >;
+   };
+   using sv_operation = make_sv_operation< std::make_integer_sequence<int, 48> >::type;
+
+   /** Counts its live instances, its copy constructor throws while copies_fail is set */
+   template<bool Boxed>
+   struct sv_throwing_copy
+   {
+      static int  live;
+      static bool copies_fail;
+      sv_throwing_copy() { ++live; }
+      sv_throwing_copy( const sv_throwing_copy& )
+      {
+         if( copies_fail )
+            throw std::runtime_error( "copy failed" );
+         ++live;
+      }
+      ~sv_throwing_copy() { --live; }
+   };
+   template<bool Boxed> int  sv_throwing_copy<Boxed>::live = 0;
+   template<bool Boxed> bool sv_throwing_copy<Boxed>::copies_fail = false;
+   using sv_throwing = fc::static_variant< std::string, sv_throwing_copy<false>, sv_throwing_copy<true> >;
+
 } } // namespace fc::test
 
+namespace fc {
+   template<> struct static_variant_inline_storage<fc::test::sv_boxed_op> : std::false_type {};
+   template<> struct static_variant_inline_storage< fc::test::sv_throwing_copy<true> > : std::false_type {};
+}
+
+FC_REFLECT_TEMPLATE( (int N), fc::test::sv_op<N>, (fee)(memo)(ids) );
+FC_REFLECT( fc::test::sv_large_op, (data) );
+FC_REFLECT( fc::test::sv_boxed_op, (name) );
+FC_REFLECT_TEMPLATE( (bool Boxed), fc::test::sv_throwing_copy<Boxed>, BOOST_PP_SEQ_NIL );
 FC_REFLECT( fc::test::item_wrapper, (v) );
 FC_REFLECT( fc::test::item, (level)(w) );
+FC_REFLECT( fc::test::api_balance, (asset_id)(amount) );
+FC_REFLECT( fc::test::api_account, (id)(name)(registrar)(expiration)(flags)(balances)(votes) );
 
 BOOST_AUTO_TEST_SUITE(fc_variant_and_log)
 
@@ -230,4 +314,267 @@ BOOST_AUTO_TEST_CASE( nested_objects_test )
 
 } FC_CAPTURE_LOG_AND_RETHROW ( (0) ) }
 
+BOOST_AUTO_TEST_CASE( variant_allocations_test )
+{ try {
+   std::vector<fc::test::api_account> accounts( 100 );
+   for( size_t i = 0; i < accounts.size(); ++i )
+   {
+      auto& a = accounts[i];
+      a.id = "1.2." + std::to_string( 10000 + i );
+      a.name = "account-" + std::to_string( i );
+      a.registrar = "1.2.17";
+      a.expiration = fc::time_point_sec( 1500000000 + i );
+      a.flags = i;
+      a.balances = { { "1.3.0", int64_t(i) * 100000 }, { "1.3.113", int64_t(i) } };
+      a.votes = { "1:" + std::to_string( i ), "0:" + std::to_string( i + 1 ) };
+   }
+
+   const std::string expected = fc::json::to_string( fc::variant( accounts, 10 ) );
+   const uint32_t rounds = 100;
+   uint64_t allocation_count;
+   fc::time_point start = fc::time_point::now();
+   {
+      fc::test::allocation_counter allocations;
+      for( uint32_t i = 0; i < rounds; ++i )
+         BOOST_REQUIRE_EQUAL( expected.size(), fc::json::to_string( fc::variant( accounts, 10 ) ).size() );
+      allocation_count = allocations.count();
+   }
+   fc::time_point end = fc::time_point::now();
+
+   BOOST_TEST_MESSAGE( "json::to_string( variant( 100 accounts ) ): " << allocation_count / rounds
+                       << " allocations, " << (end - start).count() / rounds << "us per response" );
+
+   // copies of string, blob, array and object variants are independent of the original
+   fc::variant s( std::string( "a string longer than the small string buffer" ) );
+   fc::variant b( fc::blob{ { 'a', 'b', 'c' } } );
+   fc::variant o( accounts[1], 10 );
+   fc::variant s2( s ), b2( b ), o2( o );
+   b.get_blob().data[0] = 'x';
+   s = fc::variant( 1 );
+   o = fc::variant();
+   b2 = b;
+   BOOST_CHECK_EQUAL( "a string longer than the small string buffer", s2.get_string() );
+   BOOST_CHECK_EQUAL( 'x', b2.get_blob().data[0] );
+   BOOST_CHECK_EQUAL( "account-1", o2["name"].as_string() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( static_variant_storage_test )
+{ try {
+   using fc::test::sv_operation;
+   BOOST_CHECK_EQUAL( 50u, sv_operation::count() );
+   // the largest inline alternative is sv_op, the others only need a pointer
+   BOOST_CHECK_EQUAL( sizeof(fc::test::sv_op<0>) + sizeof(sv_operation::tag_type), sizeof(sv_operation) );
+
+   fc::test::sv_large_op large;
+   large.data.fill( 'x' );
+   std::vector<sv_operation> ops = { fc::test::sv_op<3>{ 3, "three", { 1, 2, 3 } }, large,
+                                     fc::test::sv_boxed_op{ "boxed" }, fc::test::sv_op<47>() };
+   std::vector<sv_operation> copies = ops;
+   BOOST_CHECK( copies == ops );
+   BOOST_CHECK_EQUAL( "three", copies[0].get< fc::test::sv_op<3> >().memo );
+   BOOST_CHECK_EQUAL( 'x', copies[1].get< fc::test::sv_large_op >().data[1023] );
+   BOOST_CHECK_EQUAL( "boxed", copies[2].get< fc::test::sv_boxed_op >().name );
+   BOOST_CHECK_THROW( copies[2].get< fc::test::sv_op<3> >(), fc::assert_exception );
+
+   // assignments between inline and heap alternatives
+   copies[0] = ops[1];
+   copies[1] = std::move( copies[2] );
+   copies[2] = ops[0];
+   copies[3] = fc::test::sv_boxed_op{ "other" };
+   BOOST_CHECK( copies[0] == ops[1] );
+   BOOST_CHECK_EQUAL( "boxed", copies[1].get< fc::test::sv_boxed_op >().name );
+   BOOST_CHECK( copies[2] == ops[0] );
+   BOOST_CHECK_EQUAL( "other", copies[3].get< fc::test::sv_boxed_op >().name );
+   copies[3].set_which( 49 );
+   BOOST_CHECK_EQUAL( "", copies[3].get< fc::test::sv_boxed_op >().name );
+   copies[3].set_which( 5 );
+   BOOST_CHECK_EQUAL( 5u, copies[3].get< fc::test::sv_op<5> >().fee );
+
+   std::vector<sv_operation> unpacked = fc::raw::unpack< std::vector<sv_operation> >( fc::raw::pack( ops ) );
+   BOOST_CHECK( unpacked == ops );
+   BOOST_CHECK( fc::variant( ops, 10 ).as< std::vector<sv_operation> >( 10 ) == ops );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( static_variant_throwing_copy_test )
+{ try {
+   using fc::test::sv_throwing;
+   using inline_copy = fc::test::sv_throwing_copy<false>;
+   using boxed_copy = fc::test::sv_throwing_copy<true>;
+   {
+      const sv_throwing inline_value = inline_copy();
+      const sv_throwing boxed_value = boxed_copy();
+      sv_throwing target = inline_value;
+      sv_throwing moved = boxed_value;
+      inline_copy::copies_fail = boxed_copy::copies_fail = true;
+
+      // a failed assignment leaves alternative 0 behind instead of the destroyed value
+      BOOST_CHECK_THROW( target = inline_value, std::runtime_error );
+      BOOST_CHECK_EQUAL( 0, target.which() );
+      BOOST_CHECK_EQUAL( 1, inline_copy::live );
+      BOOST_CHECK_THROW( target = boxed_copy(), std::runtime_error );
+      BOOST_CHECK_EQUAL( 0, target.which() );
+      BOOST_CHECK_THROW( target = boxed_value, std::runtime_error );
+      BOOST_CHECK_EQUAL( 0, target.which() );
+      BOOST_CHECK_THROW( target = std::move( moved ), std::runtime_error );
+      BOOST_CHECK_EQUAL( 0, target.which() );
+      BOOST_CHECK_EQUAL( 2, boxed_copy::live );
+      target = std::string( "still usable" );
+      BOOST_CHECK_EQUAL( "still usable", target.get<std::string>() );
+      inline_copy::copies_fail = boxed_copy::copies_fail = false;
+   }
+   BOOST_CHECK_EQUAL( 0, inline_copy::live );
+   BOOST_CHECK_EQUAL( 0, boxed_copy::live );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( static_variant_benchmark )
+{ try {
+   using fc::test::sv_operation;
+   const size_t count = 10000;
+   std::vector<sv_operation> ops;
+   ops.reserve( count );
+   for( size_t i = 0; i < count; ++i )
+   {
+      ops.emplace_back();
+      ops.back().set_which( i % 48 );
+   }
+   const std::vector<char> packed = fc::raw::pack( ops );
+
+   const uint32_t rounds = 20;
+   fc::test::allocation_counter allocations;
+   fc::time_point start = fc::time_point::now();
+   for( uint32_t i = 0; i < rounds; ++i )
+   {
+      std::vector<sv_operation> copies( ops );
+      BOOST_REQUIRE_EQUAL( count, copies.size() );
+   }
+   fc::time_point copied = fc::time_point::now();
+   const uint64_t copy_allocations = allocations.count();
+   for( uint32_t i = 0; i < rounds; ++i )
+   {
+      std::vector<sv_operation> unpacked = fc::raw::unpack< std::vector<sv_operation> >( packed );
+      BOOST_REQUIRE_EQUAL( count, unpacked.size() );
+   }
+   fc::time_point unpacked = fc::time_point::now();
+   const uint64_t allocation_count = allocations.count();
+
+   BOOST_TEST_MESSAGE( "static_variant with 50 alternatives: copy "
+                       << double( copy_allocations ) / ( rounds * count ) << " allocations, "
+                       << ( copied - start ).count() * 1000 / ( rounds * count ) << " ns per value; unpack "
+                       << double( allocation_count - copy_allocations ) / ( rounds * count ) << " allocations, "
+                       << ( unpacked - copied ).count() * 1000 / ( rounds * count ) << " ns per value" );
+} FC_LOG_AND_RETHROW() }
+
+namespace {
+   struct sv_fee_visitor
+   {
+      typedef uint64_t result_type;
+      template<int N>
+      uint64_t operator()( const fc::test::sv_op<N>& op )const { return op.fee; }
+      template<typename T>
+      uint64_t operator()( const T& )const { return 0; }
+   };
+}
+
+BOOST_AUTO_TEST_CASE( static_variant_visit_benchmark )
+{ try {
+   using fc::test::sv_operation;
+   const size_t count = 10000;
+   std::vector<sv_operation> ops( count );
+   uint64_t expected = 0;
+   for( size_t i = 0; i < count; ++i )
+   {
+      ops[i].set_which( i % 50 );
+      expected += i % 50 < 48 ? i % 50 : 0;
+   }
+
+   const uint32_t rounds = 100;
+   uint64_t total = 0;
+   fc::time_point start = fc::time_point::now();
+   for( uint32_t r = 0; r < rounds; ++r )
+      for( const auto& op : ops )
+         total += op.visit( sv_fee_visitor() );
+   fc::time_point end = fc::time_point::now();
+
+   BOOST_CHECK_EQUAL( expected * rounds, total );
+   BOOST_CHECK_EQUAL( 1024u, fc::typelist::runtime::dispatch( sv_operation::list(), int64_t(48), []( auto t ) {
+      return sizeof( typename decltype(t)::type );
+   } ) );
+   BOOST_CHECK_THROW( fc::typelist::runtime::dispatch( sv_operation::list(), size_t(50), []( auto ) { return 0; } ),
+                      std::out_of_range );
+   BOOST_CHECK_THROW( fc::typelist::runtime::dispatch( sv_operation::list(), int64_t(-1), []( auto ) { return 0; } ),
+                      std::out_of_range );
+   BOOST_TEST_MESSAGE( "static_variant with 50 alternatives: visit "
+                       << ( end - start ).count() * 1000 / ( rounds * count ) << " ns per value" );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( variant_object_index_test )
+{ try {
+   fc::mutable_variant_object mvo;
+   for( uint32_t i = 0; i < 40; ++i )
+      mvo( "key" + std::to_string( i ), i );
+   mvo( "key7", "duplicate" );
+   BOOST_CHECK_EQUAL( 7u, mvo["key7"].as_uint64() );
+   BOOST_CHECK( mvo.find( "key40" ) == mvo.end() );
+   BOOST_CHECK( mvo.find( "" ) == mvo.end() );
+
+   // insertions after the index is built are found, copies keep their own entries
+   fc::variant_object before( mvo );
+   mvo.set( "key40", 40 );
+   mvo["key41"] = 41;
+   BOOST_CHECK_EQUAL( 40u, mvo["key40"].as_uint64() );
+   BOOST_CHECK_EQUAL( 41u, mvo["key41"].as_uint64() );
+   BOOST_CHECK( before.find( "key40" ) == before.end() );
+   BOOST_CHECK_EQUAL( 39u, before["key39"].as_uint64() );
+
+   mvo.erase( "key7" );
+   BOOST_CHECK_EQUAL( "duplicate", mvo["key7"].as_string() );
+   BOOST_CHECK_EQUAL( 8u, mvo["key8"].as_uint64() );
+
+   fc::variant_object vo( std::move( mvo ) );
+   for( uint32_t i = 0; i < 42; ++i )
+   {
+      const std::string key = "key" + std::to_string( i );
+      BOOST_REQUIRE( vo.find( key ) != vo.end() );
+      BOOST_CHECK_EQUAL( key, vo.find( key )->key() );
+   }
+
+   // assigning to a variant_object does not change the copies sharing its entries
+   fc::variant_object shared( before );
+   shared = fc::mutable_variant_object( "other", 1 );
+   BOOST_CHECK_EQUAL( 41u, before.size() );
+   BOOST_CHECK_EQUAL( 1u, shared.size() );
+   BOOST_CHECK( shared.find( "key1" ) == shared.end() );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE( variant_object_find_benchmark )
+{ try {
+   for( uint32_t fields : { 10u, 50u, 200u } )
+   {
+      std::vector<std::string> keys;
+      fc::mutable_variant_object mvo;
+      for( uint32_t i = 0; i < fields; ++i )
+      {
+         keys.push_back( "field_name_" + std::to_string( i ) );
+         mvo( keys.back(), i );
+      }
+      const fc::variant v( mvo );
+
+      // like from_variant of a reflected struct, one find per field of each object decoded
+      const uint32_t rounds = 200000 / fields;
+      uint64_t sum = 0;
+      fc::time_point start = fc::time_point::now();
+      for( uint32_t r = 0; r < rounds; ++r )
+      {
+         const fc::variant_object& vo = v.get_object();
+         for( const auto& key : keys )
+            sum += vo.find( key )->value().as_uint64();
+      }
+      fc::time_point end = fc::time_point::now();
+
+      BOOST_CHECK_EQUAL( uint64_t( rounds ) * fields * ( fields - 1 ) / 2, sum );
+      BOOST_TEST_MESSAGE( fields << " fields: " << double( ( end - start ).count() ) * 1000 / rounds
+                          << " ns per object decoded" );
+   }
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()